@@ -0,0 +1,285 @@
+#ifndef BOMBERMAN_BENCH_LEGACY_SERIALIZER_H
+#define BOMBERMAN_BENCH_LEGACY_SERIALIZER_H
+
+#include "../src/messages.h"
+
+#include <arpa/inet.h>
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+
+// Copy of NetSerializer before exact size precomputation, kept as the baseline of benchmarks.
+namespace bomberman::legacy
+{
+
+    // Class for serializing data in specific format.
+    class NetSerializer
+    {
+    public:
+        NetSerializer() {}
+        // #TODO!
+        buffer_t &serialize(client_message_t &client_message)
+        {
+            reset_state();
+            std::visit(overloaded{
+                           std::bind(&NetSerializer::write_join, this, std::placeholders::_1),
+                           std::bind(&NetSerializer::write_place_bomb, this, std::placeholders::_1),
+                           std::bind(&NetSerializer::write_place_block, this, std::placeholders::_1),
+                           std::bind(&NetSerializer::write_move, this, std::placeholders::_1),
+                       },
+                       client_message);
+
+            return buffer;
+        }
+        buffer_t &serialize(server_message_t &server_message)
+        {
+            reset_state();
+            std::visit(overloaded{
+                           std::bind(&NetSerializer::write_hello, this, std::placeholders::_1),
+                           std::bind(&NetSerializer::write_accepted_player, this, std::placeholders::_1),
+                           std::bind(&NetSerializer::write_game_started, this, std::placeholders::_1),
+                           std::bind(&NetSerializer::write_turn, this, std::placeholders::_1),
+                           std::bind(&NetSerializer::write_game_ended, this, std::placeholders::_1)},
+                       server_message);
+
+            return buffer;
+        }
+        buffer_t &serialize(draw_message_t &draw_message)
+        {
+            reset_state();
+            std::visit(overloaded{
+                           std::bind(&NetSerializer::write_lobby, this, std::placeholders::_1),
+                           std::bind(&NetSerializer::write_game, this, std::placeholders::_1),
+                       },
+                       draw_message);
+            return buffer;
+        }
+        buffer_t &serialize(targeted_message_t &targeted_message)
+        {
+            reset_state();
+            std::visit(overloaded{
+                           [this](target_one_t &target_one) { serialize(target_one.message); },
+                           [this](target_all_t &target_all) { serialize(target_all.message); },
+                       },
+                       targeted_message);
+            return buffer;
+        }
+
+    private:
+        buffer_t buffer;
+
+        void reset_state()
+        {
+            buffer.resize(0);
+        }
+
+        // Writes number in net order to buffer.
+        template <typename T>
+        void write_number(T number)
+        {
+            if constexpr (sizeof(T) == 1)
+                number = number;
+            else if constexpr (sizeof(T) == 2)
+                number = std::bit_cast<T>(htons(std::bit_cast<uint16_t>(number)));
+            else if constexpr (sizeof(T) == 4)
+                number = std::bit_cast<T>(htonl(std::bit_cast<uint32_t>(number)));
+            else
+                assert(false);
+
+            char *bytes = std::bit_cast<char *>(&number);
+            write_bytes_to_buffer(bytes, sizeof(T));
+        }
+
+        // Resize and write bytes to buffer
+        void write_bytes_to_buffer(const char *bytes, std::size_t length)
+        {
+            assert(bytes);
+            for (std::size_t i = 0; i < length; i++)
+                buffer.push_back(bytes[i]);
+        }
+
+        void write_string(const std::string &s)
+        {
+            write_number((str_len_t)s.size());
+            for (auto i = s.begin(); i != s.end(); i++)
+                buffer.push_back(*i);
+        }
+
+        void write_player(const player_t &player)
+        {
+            write_string(player.name);
+            write_string(player.address);
+        }
+
+        void write_position(const position_t &position)
+        {
+            write_number<size_x_t>(position.x);
+            write_number<size_y_t>(position.y);
+        }
+
+        void write_bomb(const bomb_t &bomb)
+        {
+            write_position(bomb.position);
+            write_number<bomb_timer_t>(bomb.timer);
+        }
+
+        void write_join(Join &join)
+        {
+            write_number<client_message_code_t>(client_message_code_t::Join);
+            write_string(join.name);
+        }
+
+        void write_place_bomb(PlaceBomb &)
+        {
+            write_number<client_message_code_t>(client_message_code_t::PlaceBomb);
+        }
+
+        void write_place_block(PlaceBlock &)
+        {
+            write_number<client_message_code_t>(client_message_code_t::PlaceBlock);
+        }
+
+        void write_move(Move &move)
+        {
+            write_number<client_message_code_t>(client_message_code_t::Move);
+            write_number<direction_t>(move.direction);
+        }
+
+        void write_lobby(Lobby &lobby)
+        {
+            write_number<draw_message_code_t>(draw_message_code_t::Lobby);
+            write_string(lobby.server_name);
+            write_number<players_count_t>(lobby.players_count);
+            write_number<size_x_t>(lobby.size_x);
+            write_number<size_y_t>(lobby.size_y);
+            write_number<game_length_t>(lobby.game_length);
+            write_number<explosion_radius_t>(lobby.explosion_radius);
+            write_number<bomb_timer_t>(lobby.bomb_timer);
+            write_number<map_len_t>((map_len_t)lobby.players.size());
+            std::for_each(lobby.players.begin(), lobby.players.end(),
+                          [this](auto &players_map_entry) {
+                              write_number<player_id_t>(players_map_entry.first);
+                              write_player(players_map_entry.second);
+                          });
+        }
+
+        void write_game(Game &game)
+        {
+            write_number<draw_message_code_t>(draw_message_code_t::Game);
+            write_string(game.server_name);
+            write_number<size_x_t>(game.size_x);
+            write_number<size_y_t>(game.size_y);
+            write_number<game_length_t>(game.game_length);
+            write_number<turn_t>(game.turn);
+            write_number<map_len_t>((map_len_t)game.players.size());
+            std::for_each(game.players.begin(), game.players.end(),
+                          [this](auto &players_map_entry) {
+                              write_number<player_id_t>(players_map_entry.first);
+                              write_player(players_map_entry.second);
+                          });
+            write_number<map_len_t>((map_len_t)game.players_positions.size());
+            std::for_each(game.players_positions.begin(), game.players_positions.end(),
+                          [this](auto &players_positions_map_entry) {
+                              write_number<player_id_t>(players_positions_map_entry.first);
+                              write_position(players_positions_map_entry.second);
+                          });
+            write_number<list_len_t>((list_len_t)game.blocks.size());
+            std::for_each(game.blocks.begin(), game.blocks.end(),
+                          [this](auto &block) {
+                              write_position(block);
+                          });
+            write_number<list_len_t>((list_len_t)game.bombs.size());
+            std::for_each(game.bombs.begin(), game.bombs.end(),
+                          [this](auto &bomb) {
+                              write_bomb(bomb);
+                          });
+            write_number<list_len_t>((list_len_t)game.explosions.size());
+            std::for_each(game.explosions.begin(), game.explosions.end(),
+                          [this](auto &explosion) {
+                              write_position(explosion);
+                          });
+            write_number<map_len_t>((map_len_t)game.scores.size());
+            for (auto &scores_map_entry : game.scores)
+            {
+                write_number<player_id_t>(scores_map_entry.first);
+                write_number<score_t>(scores_map_entry.second);
+            }
+        }
+
+        void write_hello(Hello &hello)
+        {
+            write_number<server_message_code_t>(server_message_code_t::Hello);
+            write_string(hello.server_name);
+            write_number<players_count_t>(hello.players_count);
+            write_number<size_x_t>(hello.size_x);
+            write_number<size_y_t>(hello.size_y);
+            write_number<game_length_t>(hello.game_length);
+            write_number<explosion_radius_t>(hello.explosion_radius);
+            write_number<bomb_timer_t>(hello.bomb_timer);
+        }
+
+        void write_accepted_player(AcceptedPlayer &accepted_player)
+        {
+            write_number<server_message_code_t>(server_message_code_t::AcceptedPlayer);
+            write_number<player_id_t>(accepted_player.player_id);
+            write_player(accepted_player.player);
+        }
+
+        void write_game_started(GameStarted &game_started)
+        {
+            write_number<server_message_code_t>(server_message_code_t::GameStarted);
+            write_number<map_len_t>((map_len_t)game_started.players.size());
+            for (auto &players_map_entry : game_started.players)
+            {
+                write_number<player_id_t>(players_map_entry.first);
+                write_player(players_map_entry.second);
+            }
+        }
+
+        void write_turn(Turn &turn)
+        {
+            write_number<server_message_code_t>(server_message_code_t::Turn);
+            write_number<turn_t>(turn.turn);
+            write_number<list_len_t>((list_len_t)turn.events.size());
+            turn.events.for_each(overloaded{[this](const BombPlaced &bomb_placed) {
+                                                write_number<event_code_t>(event_code_t::BombPlaced);
+                                                write_number<bomb_id_t>(bomb_placed.bomb_id);
+                                                write_position(bomb_placed.position);
+                                            },
+                                            [this](const BombExploded &bomb_exploded) {
+                                                write_number<event_code_t>(event_code_t::BombExploded);
+                                                write_number<bomb_id_t>(bomb_exploded.bomb_id);
+                                                write_number<list_len_t>((list_len_t)bomb_exploded.robots_destroyed.size());
+                                                for (const player_id_t &player_id : bomb_exploded.robots_destroyed)
+                                                    write_number<player_id_t>(player_id);
+                                                write_number<list_len_t>((list_len_t)bomb_exploded.blocks_destroyed.size());
+                                                for (const position_t &block_pos : bomb_exploded.blocks_destroyed)
+                                                    write_position(block_pos);
+                                            },
+                                            [this](const PlayerMoved &player_moved) {
+                                                write_number<event_code_t>(event_code_t::PlayerMoved);
+                                                write_number<player_id_t>(player_moved.player_id);
+                                                write_position(player_moved.position);
+                                            },
+                                            [this](const BlockPlaced &block_placed) {
+                                                write_number<event_code_t>(event_code_t::BlockPlaced);
+                                                write_position(block_placed.position);
+                                            }});
+        }
+
+        void write_game_ended(GameEnded &game_ended)
+        {
+            write_number<server_message_code_t>(server_message_code_t::GameEnded);
+            write_number<map_len_t>((map_len_t)game_ended.scores.size());
+            for (auto &scores_map_entry : game_ended.scores)
+            {
+                write_number<player_id_t>(scores_map_entry.first);
+                write_number<score_t>(scores_map_entry.second);
+            }
+        }
+    };
+
+} // namespace bomberman::legacy
+
+#endif // BOMBERMAN_BENCH_LEGACY_SERIALIZER_H
@@ -0,0 +1,132 @@
+// Compares NetSerializer with the legacy byte by byte encoder on large messages.
+// Build: g++ -std=c++20 -O2 -DBOOST_LOG_DYN_LINK net-serializer-bench.cpp -lboost_log -lpthread
+
+#include "../src/net.h"
+#include "legacy_serializer.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+
+namespace
+{
+    using namespace bomberman;
+
+    // Game frame of a crowded large board, as the client sends it to GUI.
+    Game make_game(std::minstd_rand &random)
+    {
+        Hello hello("bench server", 25, 1000, 1000, 1000, 5, 10);
+        players_t players;
+        for (player_id_t player_id = 0; player_id < 25; player_id++)
+            players.insert({player_id, player_t{.name = "player " + std::to_string(player_id), .address = "[::ffff:127.0.0.1]:40000"}});
+
+        Game game(hello, 500, players);
+        game.blocks.resize(hello.size_x, hello.size_y);
+        for (int i = 0; i < 100000; i++)
+            game.blocks.insert({static_cast<uint16_t>(random() % 1000), static_cast<uint16_t>(random() % 1000)});
+        for (const auto &[player_id, _] : players)
+        {
+            game.players_positions.insert({player_id, {static_cast<uint16_t>(random() % 1000), static_cast<uint16_t>(random() % 1000)}});
+            game.scores.insert({player_id, random() % 100});
+        }
+        for (int i = 0; i < 250; i++)
+            game.bombs.push_back(bomb_t{.position = {static_cast<uint16_t>(random() % 1000), static_cast<uint16_t>(random() % 1000)}, .timer = static_cast<bomb_timer_t>(random() % 10)});
+        for (int i = 0; i < 5000; i++)
+            game.explosions.insert({static_cast<uint16_t>(random() % 1000), static_cast<uint16_t>(random() % 1000)});
+        return game;
+    }
+
+    // Turn with many events of every kind.
+    Turn make_turn(std::minstd_rand &random)
+    {
+        events_t events;
+        for (int i = 0; i < 1000; i++)
+        {
+            const position_t position{static_cast<uint16_t>(random() % 1000), static_cast<uint16_t>(random() % 1000)};
+            switch (i % 4)
+            {
+            case 0:
+                events.push_back(BombPlaced(i, position));
+                break;
+            case 1:
+            {
+                events.push_bomb_exploded(i);
+                events.add_robot_destroyed(static_cast<player_id_t>(i % 25));
+                for (int j = 0; j < 4; j++)
+                    events.add_block_destroyed({static_cast<uint16_t>(position.x + j), position.y});
+                break;
+            }
+            case 2:
+                events.push_back(PlayerMoved(static_cast<player_id_t>(i % 25), position));
+                break;
+            default:
+                events.push_back(BlockPlaced(position));
+            }
+        }
+        return Turn(500, events);
+    }
+
+    GameStarted make_game_started()
+    {
+        players_t players;
+        for (player_id_t player_id = 0; player_id < 25; player_id++)
+            players.insert({player_id, player_t{.name = std::string(100, 'a' + player_id), .address = "[::ffff:127.0.0.1]:40000"}});
+        return GameStarted(players);
+    }
+
+    template <typename F>
+    double nanoseconds_per_call(const int iterations, F f)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++)
+            f();
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / iterations;
+    }
+
+    // Checks that both encoders produce the same bytes, then times them.
+    template <typename M>
+    bool bench(const std::string &name, M message, const int iterations)
+    {
+        legacy::NetSerializer legacy_serializer;
+        NetSerializer net_serializer;
+        buffer_t expected = legacy_serializer.serialize(message);
+        const buffer_t &encoded = net_serializer.serialize(message);
+        if (expected != encoded)
+        {
+            std::cout << name << ": encoders differ!\n";
+            return false;
+        }
+
+        std::size_t checksum = 0;
+        const double legacy_ns = nanoseconds_per_call(iterations, [&]()
+                                                      { checksum += legacy_serializer.serialize(message).size(); });
+        const double serialize_ns = nanoseconds_per_call(iterations, [&]()
+                                                         { checksum += net_serializer.serialize(message).size(); });
+        // Encoding into storage owned by the caller, reused between calls.
+        buffer_t storage;
+        const double append_ns = nanoseconds_per_call(iterations, [&]()
+                                                      {
+                                                          storage.clear();
+                                                          net_serializer.serialize_append(message, storage);
+                                                          checksum += storage.size(); });
+
+        const double bytes = static_cast<double>(expected.size());
+        std::cout << name << " (" << expected.size() << " bytes, checksum " << checksum << ")\n"
+                  << "  legacy:           " << legacy_ns << " ns, " << bytes / legacy_ns * 1e3 << " MB/s\n"
+                  << "  serialize:        " << serialize_ns << " ns, " << bytes / serialize_ns * 1e3 << " MB/s, x" << legacy_ns / serialize_ns << "\n"
+                  << "  serialize_append: " << append_ns << " ns, " << bytes / append_ns * 1e3 << " MB/s, x" << legacy_ns / append_ns << "\n";
+        return true;
+    }
+} // namespace
+
+int main()
+{
+    std::minstd_rand random(42);
+    bool ok = true;
+    ok &= bench("Game", draw_message_t(make_game(random)), 200);
+    ok &= bench("Turn", server_message_t(make_turn(random)), 20000);
+    ok &= bench("GameStarted", server_message_t(make_game_started()), 200000);
+    return ok ? 0 : 1;
+}
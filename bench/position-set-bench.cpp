@@ -0,0 +1,131 @@
+// Compares position_set_t and position_map_t with node based std::unordered_* containers, using the
+// mixing position hash and the former x ^ y hash, on sparse positions of a huge board and on a diagonal.
+// Build: g++ -std=c++20 -O2 -DBOOST_LOG_DYN_LINK position-set-bench.cpp -lboost_log -lpthread
+
+#include "../src/position_set.h"
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace
+{
+    using namespace bomberman;
+
+    // Hash used before position_t::hash mixed packed positions. (a, b) and (b, a) collide and all cells
+    // with x == y hash to 0.
+    struct xor_hash
+    {
+        std::size_t operator()(const position_t &position) const noexcept
+        {
+            return std::hash<uint16_t>{}(position.x) ^ std::hash<uint16_t>{}(position.y);
+        }
+    };
+
+    template <typename F>
+    double nanoseconds_per_op(const std::size_t ops, F f)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        f();
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / static_cast<double>(ops);
+    }
+
+    // Inserts positions, looks up all of them and as many absent ones, then iterates the set.
+    template <typename Set>
+    void bench_set(const std::string &name, const std::vector<position_t> &positions, const std::vector<position_t> &absent)
+    {
+        Set set;
+        std::size_t checksum = 0;
+        const double insert_ns = nanoseconds_per_op(positions.size(), [&]()
+                                                    {
+                                                        for (const position_t &position : positions)
+                                                            set.insert(position); });
+        const double hit_ns = nanoseconds_per_op(positions.size(), [&]()
+                                                 {
+                                                     for (const position_t &position : positions)
+                                                         checksum += set.contains(position); });
+        const double miss_ns = nanoseconds_per_op(absent.size(), [&]()
+                                                  {
+                                                      for (const position_t &position : absent)
+                                                          checksum += set.contains(position); });
+        const double iterate_ns = nanoseconds_per_op(set.size(), [&]()
+                                                     {
+                                                         for (const position_t &position : set)
+                                                             checksum += position.x; });
+        std::cout << "  " << name << ": insert " << insert_ns << " ns, hit " << hit_ns << " ns, miss " << miss_ns
+                  << " ns, iterate " << iterate_ns << " ns (checksum " << checksum << ")\n";
+    }
+
+    // Inserts positions with values, then looks all of them up.
+    template <typename Map>
+    void bench_map(const std::string &name, const std::vector<position_t> &positions)
+    {
+        Map map;
+        std::size_t checksum = 0;
+        const double insert_ns = nanoseconds_per_op(positions.size(), [&]()
+                                                    {
+                                                        uint32_t value = 0;
+                                                        for (const position_t &position : positions)
+                                                            map[position] = value++; });
+        const double find_ns = nanoseconds_per_op(positions.size(), [&]()
+                                                  {
+                                                      for (const position_t &position : positions)
+                                                      {
+                                                          if constexpr (requires { map.find(position)->second; })
+                                                              checksum += map.find(position)->second;
+                                                          else
+                                                              checksum += *map.find(position);
+                                                      } });
+        std::cout << "  " << name << ": insert " << insert_ns << " ns, find " << find_ns << " ns (checksum " << checksum << ")\n";
+    }
+
+    void bench_all(const std::string &name, const std::vector<position_t> &positions, const std::vector<position_t> &absent)
+    {
+        std::cout << name << " (" << positions.size() << " positions)\n";
+        bench_set<std::unordered_set<position_t, xor_hash>>("unordered_set, x ^ y hash", positions, absent);
+        bench_set<std::unordered_set<position_t, position_t::hash>>("unordered_set, mixed hash", positions, absent);
+        bench_set<position_set_t>("position_set_t", positions, absent);
+        bench_map<std::unordered_map<position_t, uint32_t, position_t::hash>>("unordered_map, mixed hash", positions);
+        bench_map<position_map_t<uint32_t>>("position_map_t", positions);
+    }
+} // namespace
+
+int main()
+{
+    std::minstd_rand random(42);
+    auto random_position = [&random]()
+    {
+        return position_t{static_cast<uint16_t>(random()), static_cast<uint16_t>(random())};
+    };
+
+    // Blocks scattered over a 65536 x 65536 board, far too big for a dense bitmap.
+    std::vector<position_t> sparse, sparse_absent;
+    position_set_t seen;
+    while (sparse.size() < 1000000)
+    {
+        const position_t position = random_position();
+        if (seen.insert(position))
+            sparse.push_back(position);
+    }
+    while (sparse_absent.size() < 1000000)
+    {
+        const position_t position = random_position();
+        if (!seen.contains(position))
+            sparse_absent.push_back(position);
+    }
+    bench_all("sparse", sparse, sparse_absent);
+
+    // Wall along the diagonal, every cell collides under x ^ y.
+    std::vector<position_t> diagonal, diagonal_absent;
+    for (uint16_t i = 0; i < 20000; i++)
+    {
+        diagonal.push_back({i, i});
+        diagonal_absent.push_back({i, static_cast<uint16_t>(i + 1)});
+    }
+    bench_all("diagonal", diagonal, diagonal_absent);
+    return 0;
+}
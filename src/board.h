@@ -0,0 +1,403 @@
+#ifndef BOMBERMAN_BOARD_H
+#define BOMBERMAN_BOARD_H
+
+#include "position_set.h"
+#include "types.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <vector>
+
+namespace bomberman
+{
+
+    // Dense bitmap of occupied cells, stored row-major with every row padded to whole 64-bit words.
+    // Membership checks are a single shift and mask, iteration skips empty words using countr_zero.
+    // A transposed copy (column-major) is kept as well, so rays along both axes can find the nearest
+    // occupied cell with find-first-set instead of visiting cells one by one.
+    // Boards with more than SPARSE_CELLS cells would need too much memory for bitmaps, blocks of such
+    // boards are kept in position_set_t and rays visit cells one by one.
+    class board_t
+    {
+    public:
+        using word_t = uint64_t;
+        static constexpr std::size_t WORD_BITS = 64;
+        // 8192 x 8192 cells, 8 MiB for each bitmap.
+        static constexpr std::size_t SPARSE_CELLS = std::size_t{1} << 26;
+
+        class iterator
+        {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = position_t;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const position_t *;
+            using reference = const position_t &;
+
+            iterator() : board_(nullptr), word_idx_(0), word_(0) {}
+            iterator(const board_t *board, std::size_t word_idx)
+                : board_(board), word_idx_(word_idx), word_(0)
+            {
+                if (word_idx_ < board_->words_.size())
+                    word_ = board_->words_[word_idx_];
+                skip_empty_words();
+            }
+            // Iterator of sparse board.
+            explicit iterator(position_set_t::iterator sparse_it)
+                : board_(nullptr), word_idx_(0), word_(0), sparse_it_(sparse_it) {}
+
+            reference operator*() const noexcept { return board_ ? position_ : *sparse_it_; }
+            pointer operator->() const noexcept { return &**this; }
+
+            iterator &operator++() noexcept
+            {
+                if (!board_)
+                {
+                    ++sparse_it_;
+                    return *this;
+                }
+                // Clear lowest set bit.
+                word_ &= word_ - 1;
+                skip_empty_words();
+                return *this;
+            }
+
+            iterator operator++(int) noexcept
+            {
+                iterator result = *this;
+                ++*this;
+                return result;
+            }
+
+            bool operator==(const iterator &other) const noexcept
+            {
+                return word_idx_ == other.word_idx_ && word_ == other.word_ && sparse_it_ == other.sparse_it_;
+            }
+
+        private:
+            void skip_empty_words() noexcept
+            {
+                const std::size_t words_count = board_->words_.size();
+                while (!word_)
+                {
+                    if (++word_idx_ >= words_count)
+                    {
+                        word_idx_ = words_count;
+                        return;
+                    }
+                    word_ = board_->words_[word_idx_];
+                }
+                const std::size_t row = word_idx_ / board_->words_per_row_;
+                const std::size_t column_word = word_idx_ - row * board_->words_per_row_;
+                position_.x = static_cast<size_x_t>(column_word * WORD_BITS + std::countr_zero(word_));
+                position_.y = static_cast<size_y_t>(row);
+            }
+
+            const board_t *board_;
+            std::size_t word_idx_;
+            word_t word_;
+            position_t position_;
+            position_set_t::iterator sparse_it_;
+        };
+
+        board_t() : size_x_(0), size_y_(0), words_per_row_(1), words_per_column_(1), count_(0), sparse_(false), words_(1, 0), column_words_(1, 0) {}
+        board_t(size_x_t size_x, size_y_t size_y) : board_t() { resize(size_x, size_y); }
+
+        // Sets board dimensions and removes all blocks.
+        void resize(size_x_t size_x, size_y_t size_y)
+        {
+            size_x_ = size_x;
+            size_y_ = size_y;
+            count_ = 0;
+            sparse_blocks_.clear();
+            sparse_ = static_cast<std::size_t>(size_x) * size_y > SPARSE_CELLS;
+            if (sparse_) [[unlikely]]
+            {
+                words_per_row_ = words_per_column_ = 1;
+                words_.assign(1, 0);
+                column_words_.assign(1, 0);
+                return;
+            }
+            words_per_row_ = std::max<std::size_t>(1, (size_x + WORD_BITS - 1) / WORD_BITS);
+            words_per_column_ = std::max<std::size_t>(1, (size_y + WORD_BITS - 1) / WORD_BITS);
+            words_.assign(std::max<std::size_t>(1, words_per_row_ * size_y), 0);
+            column_words_.assign(std::max<std::size_t>(1, words_per_column_ * size_x), 0);
+        }
+
+        // Removes all blocks, dimensions stay the same.
+        void clear()
+        {
+            std::fill(words_.begin(), words_.end(), 0);
+            std::fill(column_words_.begin(), column_words_.end(), 0);
+            sparse_blocks_.clear();
+            count_ = 0;
+        }
+
+        bool contains(const position_t &position) const noexcept
+        {
+            if (sparse_) [[unlikely]]
+                return sparse_blocks_.contains(position);
+            // Out of board positions are masked to word 0 and bit result 0 instead of branching.
+            const word_t in_range = (position.x < size_x_) & (position.y < size_y_);
+            const std::size_t idx = word_index(position) * in_range;
+            return (words_[idx] >> (position.x % WORD_BITS)) & in_range;
+        }
+
+        // Returns true if block was placed, false if it was already there or position is outside the board.
+        bool insert(const position_t &position)
+        {
+            if (position.x >= size_x_ || position.y >= size_y_)
+                return false;
+            if (sparse_) [[unlikely]]
+            {
+                const bool inserted = sparse_blocks_.insert(position);
+                count_ += inserted;
+                return inserted;
+            }
+            word_t &word = words_[word_index(position)];
+            const word_t mask = word_t{1} << (position.x % WORD_BITS);
+            const bool inserted = !(word & mask);
+            word |= mask;
+            column_words_[column_word_index(position)] |= word_t{1} << (position.y % WORD_BITS);
+            count_ += inserted;
+            return inserted;
+        }
+
+        // Returns true if block was removed.
+        bool erase(const position_t &position) noexcept
+        {
+            if (position.x >= size_x_ || position.y >= size_y_)
+                return false;
+            if (sparse_) [[unlikely]]
+            {
+                const bool erased = sparse_blocks_.erase(position);
+                count_ -= erased;
+                return erased;
+            }
+            word_t &word = words_[word_index(position)];
+            const word_t mask = word_t{1} << (position.x % WORD_BITS);
+            const bool erased = word & mask;
+            word &= ~mask;
+            column_words_[column_word_index(position)] &= ~(word_t{1} << (position.y % WORD_BITS));
+            count_ -= erased;
+            return erased;
+        }
+
+        std::size_t size() const noexcept { return count_; }
+        bool empty() const noexcept { return count_ == 0; }
+        size_x_t size_x() const noexcept { return size_x_; }
+        size_y_t size_y() const noexcept { return size_y_; }
+
+        iterator begin() const { return sparse_ ? iterator(sparse_blocks_.begin()) : iterator(this, 0); }
+        iterator end() const { return sparse_ ? iterator(sparse_blocks_.end()) : iterator(this, words_.size()); }
+
+        // Returns distance from position to the nearest block in given direction (position itself is at
+        // distance 0), or limit if there is no block within limit cells. Position must be on the board.
+        std::size_t distance_to_block(const position_t &position, const direction_t direction, const std::size_t limit) const noexcept
+        {
+            if (sparse_) [[unlikely]]
+                return sparse_distance(position, direction, limit);
+            switch (direction)
+            {
+            case direction_t::Up:
+                return forward_distance(column_words_.data() + position.x * words_per_column_, position.y, limit);
+            case direction_t::Right:
+                return forward_distance(words_.data() + position.y * words_per_row_, position.x, limit);
+            case direction_t::Down:
+                return backward_distance(column_words_.data() + position.x * words_per_column_, position.y, limit);
+            case direction_t::Left:
+                return backward_distance(words_.data() + position.y * words_per_row_, position.x, limit);
+            }
+            return limit;
+        }
+
+        bool operator==(const board_t &other) const noexcept
+        {
+            return size_x_ == other.size_x_ && size_y_ == other.size_y_ && words_ == other.words_ &&
+                   sparse_blocks_ == other.sparse_blocks_;
+        }
+
+    private:
+        std::size_t word_index(const position_t &position) const noexcept
+        {
+            return static_cast<std::size_t>(position.y) * words_per_row_ + position.x / WORD_BITS;
+        }
+
+        std::size_t column_word_index(const position_t &position) const noexcept
+        {
+            return static_cast<std::size_t>(position.x) * words_per_column_ + position.y / WORD_BITS;
+        }
+
+        std::size_t sparse_distance(position_t position, const direction_t direction, const std::size_t limit) const noexcept
+        {
+            for (std::size_t distance = 0; distance < limit; distance++)
+            {
+                if (sparse_blocks_.contains(position))
+                    return distance;
+                switch (direction)
+                {
+                case direction_t::Up:
+                    position.y++;
+                    break;
+                case direction_t::Right:
+                    position.x++;
+                    break;
+                case direction_t::Down:
+                    position.y--;
+                    break;
+                case direction_t::Left:
+                    position.x--;
+                    break;
+                }
+            }
+            return limit;
+        }
+
+        // Finds first set bit at index >= start in line of bits and returns its distance from start capped at limit.
+        static std::size_t forward_distance(const word_t *line, const std::size_t start, const std::size_t limit) noexcept
+        {
+            std::size_t word_idx = start / WORD_BITS;
+            word_t word = line[word_idx] & (~word_t{0} << (start % WORD_BITS));
+            while (true)
+            {
+                if (word)
+                    return std::min(word_idx * WORD_BITS + std::countr_zero(word) - start, limit);
+                if ((word_idx + 1) * WORD_BITS - start > limit)
+                    return limit;
+                word = line[++word_idx];
+            }
+        }
+
+        // Finds last set bit at index <= start in line of bits and returns its distance from start capped at limit.
+        static std::size_t backward_distance(const word_t *line, const std::size_t start, const std::size_t limit) noexcept
+        {
+            std::size_t word_idx = start / WORD_BITS;
+            word_t word = line[word_idx] & (~word_t{0} >> (WORD_BITS - 1 - start % WORD_BITS));
+            while (true)
+            {
+                if (word)
+                    return std::min(start - (word_idx * WORD_BITS + WORD_BITS - 1 - std::countl_zero(word)), limit);
+                if (!word_idx || start - word_idx * WORD_BITS + 1 > limit)
+                    return limit;
+                word = line[--word_idx];
+            }
+        }
+
+        size_x_t size_x_;
+        size_y_t size_y_;
+        std::size_t words_per_row_;
+        std::size_t words_per_column_;
+        std::size_t count_;
+        bool sparse_;
+        std::vector<word_t> words_;
+        std::vector<word_t> column_words_;
+        position_set_t sparse_blocks_;
+    };
+
+    using blocks_t = board_t;
+
+    // Spatial index of players positions. Every player is stored twice, keyed by its position packed
+    // row-major and column-major, so all players on a horizontal or vertical segment are one range lookup.
+    class occupancy_t
+    {
+    public:
+        void clear()
+        {
+            by_row_.clear();
+            by_column_.clear();
+        }
+
+        void insert(const player_id_t player_id, const position_t &position)
+        {
+            by_row_.insert({row_key(position), player_id});
+            by_column_.insert({column_key(position), player_id});
+        }
+
+        void erase(const player_id_t player_id, const position_t &position)
+        {
+            erase_from(by_row_, row_key(position), player_id);
+            erase_from(by_column_, column_key(position), player_id);
+        }
+
+        // Nodes of the player are reused, so moving does not allocate.
+        void move(const player_id_t player_id, const position_t &from, const position_t &to)
+        {
+            move_in(by_row_, row_key(from), row_key(to), player_id);
+            move_in(by_column_, column_key(from), column_key(to), player_id);
+        }
+
+        // Calls f(player_id) for every player in row y with x_from <= x <= x_to.
+        template <typename F>
+        void for_each_in_row(const size_y_t y, const size_x_t x_from, const size_x_t x_to, F f) const
+        {
+            for_each_in_range(by_row_, row_key({.x = x_from, .y = y}), row_key({.x = x_to, .y = y}), f);
+        }
+
+        // Calls f(player_id) for every player in column x with y_from <= y <= y_to.
+        template <typename F>
+        void for_each_in_column(const size_x_t x, const size_y_t y_from, const size_y_t y_to, F f) const
+        {
+            for_each_in_range(by_column_, column_key({.x = x, .y = y_from}), column_key({.x = x, .y = y_to}), f);
+        }
+
+    private:
+        using index_t = std::multimap<uint32_t, player_id_t>;
+
+        static uint32_t row_key(const position_t &position) noexcept
+        {
+            return (static_cast<uint32_t>(position.y) << 16) | position.x;
+        }
+
+        static uint32_t column_key(const position_t &position) noexcept
+        {
+            return (static_cast<uint32_t>(position.x) << 16) | position.y;
+        }
+
+        static index_t::iterator find(index_t &index, const uint32_t key, const player_id_t player_id)
+        {
+            auto [it, last] = index.equal_range(key);
+            for (; it != last; ++it)
+            {
+                if (it->second == player_id)
+                    return it;
+            }
+            return index.end();
+        }
+
+        static void erase_from(index_t &index, const uint32_t key, const player_id_t player_id)
+        {
+            auto it = find(index, key, player_id);
+            if (it != index.end())
+                index.erase(it);
+        }
+
+        static void move_in(index_t &index, const uint32_t from, const uint32_t to, const player_id_t player_id)
+        {
+            auto it = find(index, from, player_id);
+            if (it == index.end())
+            {
+                index.insert({to, player_id});
+                return;
+            }
+            auto node = index.extract(it);
+            node.key() = to;
+            index.insert(std::move(node));
+        }
+
+        template <typename F>
+        static void for_each_in_range(const index_t &index, const uint32_t key_from, const uint32_t key_to, F &f)
+        {
+            for (auto it = index.lower_bound(key_from); it != index.end() && it->first <= key_to; ++it)
+                f(it->second);
+        }
+
+        index_t by_row_;
+        index_t by_column_;
+    };
+
+} // namespace bomberman
+
+#endif // BOMBERMAN_BOARD_H
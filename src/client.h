@@ -10,12 +10,20 @@
 #include <boost/asio.hpp>
 #include <boost/log/trivial.hpp>
 #include <boost/program_options.hpp>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <deque>
 #include <iostream>
 #include <optional>
 #include <queue>
 #include <tuple>
 
 #include "common.h"
+#include "gui_frame.h"
 #include "net.h"
 
 namespace bomberman
@@ -31,12 +39,40 @@ namespace bomberman
       std::string s2 = s.substr(split_idx + 1);
       return {s1, s2};
     }
+
+    // This function is used to parse two 16-bit numbers separated by given character, like 40x30.
+    std::pair<uint16_t, uint16_t> parse_pair(const std::string &s, const char separator)
+    {
+      const auto split_idx = s.find(separator);
+      if (split_idx == std::string::npos)
+        throw InvalidArguments("expected two numbers separated by " + std::string(1, separator));
+      const unsigned long first = std::stoul(s.substr(0, split_idx));
+      const unsigned long second = std::stoul(s.substr(split_idx + 1));
+      if (first > std::numeric_limits<uint16_t>::max() || second > std::numeric_limits<uint16_t>::max())
+        throw InvalidArguments("numbers must be unsigned 16-bits integers");
+      return {static_cast<uint16_t>(first), static_cast<uint16_t>(second)};
+    }
   } // namespace
 
   struct robots_client_args_t
   {
     std::string server_endpoint_input, gui_endpoint_input, player_name;
     uint16_t port;
+    // Game frames are sent to GUI at most once per this interval, 0 means after every burst of turns.
+    std::chrono::milliseconds draw_interval;
+    // Show own robot moved before the server confirms it.
+    bool predict;
+    // Width and height of the part of the board shown around own robot, whole board if not given.
+    std::optional<std::pair<uint16_t, uint16_t>> viewport;
+    // Center of the viewport when the client has no robot.
+    std::optional<position_t> focus;
+  };
+
+  // Message waiting to be sent to GUI.
+  struct gui_datagram_t
+  {
+    buffer_t data;
+    bool game_frame;
   };
 
   class RobotsClient
@@ -51,7 +87,13 @@ namespace bomberman
           server_deserializer_(server_socket_),
           gui_deserializer_(gui_socket_),
           player_name_(args.player_name),
-          state_(LOBBY)
+          state_(LOBBY),
+          predict_(args.predict),
+          viewport_(args.viewport),
+          focus_(args.focus),
+          draw_timer_(io_context),
+          draw_interval_(args.draw_interval),
+          last_draw_(std::chrono::steady_clock::time_point::min())
     {
       boost::system::error_code ec;
 
@@ -61,6 +103,9 @@ namespace bomberman
       gui_endpoints = gui_resolver.resolve(gui_host, gui_port, ec);
       if (ec)
         throw InvalidArguments("Invalid GUI endpoint", ec);
+      gui_endpoint_ = *gui_endpoints;
+      // GUI datagrams are sent with sendmmsg, which must not block the io_context.
+      gui_socket_.non_blocking(true);
       // Call read from gui loop.
       read_from_gui();
       // --- --- ---
@@ -131,32 +176,33 @@ namespace bomberman
       // This function should not be calld when input_messages_q_ is empty.
       assert(!input_messages_q_.empty());
 
-      // If client_messages_q_ is not empty, it means that asynchonus sending is in progress and we only need to add new message to queue..
-      // If not, then we have to call send_to_server after adding message to queue.
-      // The same logic is implmented in handle_server_message
-      bool send_in_progress = !client_messages_q_.empty();
-
       while (!input_messages_q_.empty())
       {
         if (state_ == LOBBY)
         {
-          client_messages_q_.push(Join{player_name_});
+          // One Join waiting to be sent is enough.
+          if (!join_queued_)
+          {
+            client_messages_q_.emplace(std::in_place_type<Join>, player_name_);
+            join_queued_ = true;
+          }
           // Clear qui messages queue because we are not in game yet.
           input_messages_q_ = std::queue<input_message_t>();
         }
         else if (state_ == IN_GAME)
         {
-          input_message_t input_message = input_messages_q_.front();
-          std::visit(
+          client_message_t client_message = std::visit(
               overloaded{
-                  [this](PlaceBomb &) { client_messages_q_.push(PlaceBomb{}); },
-                  [this](PlaceBlock &) { client_messages_q_.push(PlaceBlock{}); },
-                  [this](Move &msg) {
-                    client_messages_q_.push(Move{msg.direction});
-                  },
+                  [](PlaceBomb &) -> client_message_t { return PlaceBomb{}; },
+                  [](PlaceBlock &) -> client_message_t { return PlaceBlock{}; },
+                  [](Move &msg) -> client_message_t { return Move{msg.direction}; },
               },
-              input_message);
+              input_messages_q_.front());
           input_messages_q_.pop();
+          // Server applies only the first message of a player in every turn and drops the rest. So the first
+          // input of a turn is sent at once and the following ones are dropped here.
+          if (!input_sent_this_turn_)
+            send_input(client_message);
         }
         else if (state_ == OBSERVE)
         {
@@ -166,18 +212,92 @@ namespace bomberman
         }
       }
 
-      if (!send_in_progress && !client_messages_q_.empty())
+      send_to_server();
+    }
+
+    // Queues the input which takes effect in the current turn.
+    void send_input(const client_message_t &client_message)
+    {
+      client_messages_q_.push(client_message);
+      input_sent_this_turn_ = true;
+      if (predict_ && std::holds_alternative<Move>(client_message))
+        predict_move(std::get<Move>(client_message).direction);
+    }
+
+    // --- PREDICTION ---
+    // With prediction on, own robot is shown where the server will move it as soon as Move is sent,
+    // computed the same way as by the server. The prediction is kept until a turn moves own robot, as
+    // Move may reach the server only after the next turn was sent.
+    void predict_move(const direction_t direction)
+    {
+      if (!own_id_.has_value())
+        return;
+      auto position_it = game_state_.player_to_position.find(*own_id_);
+      if (position_it == game_state_.player_to_position.end())
+        return;
+      const std::optional<position_t> new_position =
+          calculate_move(position_it->second, direction, game_state_.blocks);
+      if (!new_position.has_value())
+        return;
+      prediction_ = prediction_t{.from = position_it->second,
+                                 .direction = direction,
+                                 .position = *new_position,
+                                 .turn = game_state_.turn};
+      frame_changes_.players_positions = true;
+      schedule_draw();
+    }
+
+    // Tells if Move of the prediction may still be applied by the server after given turn. It is not if
+    // own robot was moved or destroyed, if Move is blocked now or if it is too old to be still on its way.
+    bool prediction_holds(const Turn &turn) const
+    {
+      for (const PlayerMoved &player_moved : turn.events.players_moved())
+      {
+        if (player_moved.player_id == *own_id_)
+          return false;
+      }
+      auto position_it = game_state_.player_to_position.find(*own_id_);
+      if (position_it == game_state_.player_to_position.end() || position_it->second != prediction_->from)
+        return false;
+      if (turn.turn > prediction_->turn + PREDICTION_TURNS)
+        return false;
+      return calculate_move(prediction_->from, prediction_->direction, game_state_.blocks) == prediction_->position;
+    }
+
+    // Server puts address of the connection from which player joined in player_t.
+    void find_own_id(const players_t &players)
+    {
+      if (!(predict_ || viewport_.has_value()) || own_id_.has_value())
+        return;
+      boost::system::error_code ec;
+      const auto endpoint = server_socket_.local_endpoint(ec);
+      if (ec)
+        return;
+      const std::string port = "]:" + std::to_string(endpoint.port());
+      std::vector<std::string> addresses{"[" + endpoint.address().to_string() + port};
+      // IPv4 connection is seen as IPv4 mapped address by server listening on IPv6.
+      if (endpoint.address().is_v4())
+        addresses.push_back("[" + boost::asio::ip::make_address_v6(boost::asio::ip::v4_mapped, endpoint.address().to_v4()).to_string() + port);
+      for (const auto &[player_id, player] : players)
       {
-        send_to_server();
+        if (player.name == player_name_ &&
+            std::find(addresses.begin(), addresses.end(), player.address) != addresses.end())
+        {
+          own_id_ = player_id;
+          BOOST_LOG_TRIVIAL(debug) << "own player id: " << static_cast<int>(player_id);
+          return;
+        }
       }
     }
+    // --- END OF PREDICTION ---
 
     // --- SERVER MESSAGES PROCESSING ---
     void process_hello(const Hello &hello)
     {
       hello_ = hello;
-      Lobby lobby(hello_, game_state_.players);
-      draw_messages_q_.push(lobby);
+      flush_draw();
+      game_state_.blocks.resize(hello_.size_x, hello_.size_y);
+      send_to_gui(Lobby(hello_, game_state_.players));
     }
 
     void process_accepted_player(const AcceptedPlayer &accepted_player)
@@ -185,28 +305,40 @@ namespace bomberman
       // Register new player and send message to GUI.
       game_state_.players.insert(
           {accepted_player.player_id, accepted_player.player});
-      Lobby lobby(hello_, game_state_.players);
-      draw_messages_q_.push(lobby);
+      find_own_id(game_state_.players);
+      flush_draw();
+      send_to_gui(Lobby(hello_, game_state_.players));
     }
 
     void process_game_started(const GameStarted &game_started)
     {
+      // Server sends GameStarted again to a client which missed turns, state is built from scratch then.
+      game_state_.reset();
+      turn_processed_ = false;
+      explosions_.clear();
+      prediction_.reset();
       // Set players and change state to IN_GAME
       game_state_.players = game_started.players;
       state_ = client_state_t::IN_GAME;
+      input_sent_this_turn_ = false;
+      find_own_id(game_state_.players);
       for (auto &players_map_entry : game_state_.players)
         game_state_.scores.insert({players_map_entry.first, 0});
+      game_frame_.start(hello_, game_state_.players);
+      game_frame_.set(game_frame_t::SCORES, game_state_.scores);
+      block_tiles_.clear();
+      drawn_tiles_.reset();
     }
 
-    void process_bomb_placed(const BombPlaced &bomb_placed)
+    void process_bomb_placed(const BombPlaced &bomb_placed, const turn_t turn)
     {
       game_state_.bombs.insert(
           {bomb_placed.bomb_id,
-           bomb_t{.position = bomb_placed.position,
-                  .timer = hello_.bomb_timer}});
+           placed_bomb_t{.position = bomb_placed.position,
+                         .placed_turn = turn}});
     }
 
-    void process_bomb_exploded(const BombExploded &bomb_exploded, Game &game, std::unordered_set<player_id_t> &who_to_add_score, std::unordered_set<position_t, position_t::hash> &blocks_destroyed)
+    void process_bomb_exploded(const BombExploded &bomb_exploded, std::unordered_set<player_id_t> &who_to_add_score, blocks_destroyed_t &blocks_destroyed)
     {
       // Find bomb by id to get it's position.
       auto exploded_bomb_it =
@@ -218,12 +350,12 @@ namespace bomberman
       else
       {
         // Add blocks within explosion range and erase exploded bomb.
-        auto explosions = calculate_explosion_range(
+        const explosion_t explosion = calculate_explosion(
             exploded_bomb_it->second.position,
-            hello_.explosion_radius, hello_.size_x,
-            hello_.size_y, game_state_.blocks);
-        for (const auto &explosion : explosions)
-          game.explosions.insert(explosion);
+            hello_.explosion_radius, game_state_.blocks);
+        explosion.for_each_cell([this](const position_t &position) {
+          explosions_.insert(position);
+        });
         game_state_.bombs.erase(exploded_bomb_it);
       }
 
@@ -251,58 +383,90 @@ namespace bomberman
     void process_block_placed(const BlockPlaced &block_placed)
     {
       // Add new block.
-      game_state_.blocks.insert(block_placed.position);
+      if (game_state_.blocks.insert(block_placed.position))
+      {
+        if (viewport_.has_value())
+          add_viewport_block(block_placed.position);
+        else
+          game_frame_.add_block(block_placed.position);
+      }
     }
 
     void process_turn(const Turn &turn)
     {
-      Game game(hello_, turn.turn, game_state_.players);
+      // Turn not newer than the last one only catches up with state the client missed, like snapshot sent
+      // to late joiners or to a player whose interest region moved. It does not start a new turn.
+      const bool catch_up = turn_processed_ && turn.turn <= game_state_.turn;
       // Each player whose robot was at least once destroyed gets point.
       std::unordered_set<player_id_t> who_to_add_score;
       // Blocks destroyed are set after all events are processed to properly calculate explosion.
-      std::unordered_set<position_t, position_t::hash> blocks_destroyed;
-      
-      // Decrease each bomb timer.
-      for (auto &bomb_pair : game_state_.bombs)
+      blocks_destroyed_t blocks_destroyed;
+      // Frame shows explosions of the last turn only.
+      if (!catch_up)
+        explosions_.clear();
+      // Bomb timers change every turn, so bombs are encoded again if there were or are any.
+      const bool had_bombs = !game_state_.bombs.empty();
+
+      // Events are applied in the order they happened.
+      turn.events.for_each(
+          overloaded{
+              std::bind(&RobotsClient::process_bomb_placed, this, std::placeholders::_1, turn.turn),
+              std::bind(&RobotsClient::process_bomb_exploded, this, std::placeholders::_1, std::ref(who_to_add_score), std::ref(blocks_destroyed)),
+              std::bind(&RobotsClient::process_player_moved, this, std::placeholders::_1),
+              std::bind(&RobotsClient::process_block_placed, this, std::placeholders::_1),
+          });
+      for (const auto &player : who_to_add_score)
       {
-        if (bomb_pair.second.timer > 0)
-          bomb_pair.second.timer--;
+        game_state_.scores[player]++;
+      }
+      // Erase destroyed blocks
+      for (const auto &block_destroyed : blocks_destroyed)
+      {
+        if (game_state_.blocks.erase(block_destroyed))
+        {
+          if (viewport_.has_value())
+            remove_viewport_block(block_destroyed);
+          else
+            game_frame_.remove_block(block_destroyed);
+        }
       }
 
-      for (const event_t &event : turn.events)
+      // Blocks of GUI frame are already updated, other parts changed by this turn are encoded when frame is sent.
+      frame_changes_.players_positions |= !turn.events.players_moved().empty() || turn.events.robots_destroyed_count();
+      frame_changes_.bombs |= had_bombs || !game_state_.bombs.empty();
+      frame_changes_.scores |= !who_to_add_score.empty();
+      if (catch_up)
       {
-        std::visit(
-            overloaded{
-                std::bind(&RobotsClient::process_bomb_placed, this, std::placeholders::_1),
-                std::bind(&RobotsClient::process_bomb_exploded, this, std::placeholders::_1, std::ref(game), std::ref(who_to_add_score), std::ref(blocks_destroyed)),
-                std::bind(&RobotsClient::process_player_moved, this, std::placeholders::_1),
-                std::bind(&RobotsClient::process_block_placed, this, std::placeholders::_1),
-            },
-            event);
+        schedule_draw();
+        return;
       }
-      for (const auto &player : who_to_add_score)
+      turn_processed_ = true;
+      frame_changes_.turn = turn.turn;
+      game_state_.turn = turn.turn;
+      // Server position replaces the predicted one once Move was applied or can not be anymore.
+      if (prediction_.has_value() && !prediction_holds(turn))
       {
-        game_state_.scores[player]++;
+        prediction_.reset();
+        frame_changes_.players_positions = true;
       }
-      // Erase destroyed blocks
-      for (const auto &block_destroyed : blocks_destroyed)
-        game_state_.blocks.erase(block_destroyed);
-      // Set information in message to GUI .
-      game.players_positions = game_state_.player_to_position;
-      game.blocks = game_state_.blocks;
-      game.bombs = game_state_.bombs;
-      game.scores = game_state_.scores;
-      draw_messages_q_.push(game);
+
+      // Next input takes effect in the next turn.
+      input_sent_this_turn_ = false;
+      schedule_draw();
     }
 
     // Maybe unused because in debug we want to assert scores but in release we do not use game_ended.
     void process_game_ended(const GameEnded &game_ended [[maybe_unused]])
     {
       assert(game_ended.scores == game_state_.scores);
+      // The last frame of the game is shown before the lobby.
+      flush_draw();
       game_state_.reset();
+      turn_processed_ = false;
       state_ = client_state_t::LOBBY;
-      Lobby lobby(hello_, game_state_.players);
-      draw_messages_q_.push(lobby);
+      prediction_.reset();
+      own_id_.reset();
+      send_to_gui(Lobby(hello_, game_state_.players));
     }
     // --- END OF SERVER MESSAGES PROCESSING ---
 
@@ -314,7 +478,6 @@ namespace bomberman
       // Update game state according to received message and send updated state to GUI.
       while (!server_messages_q_.empty())
       {
-        bool send_in_progress = !draw_messages_q_.empty();
         std::visit(
             overloaded{
                 std::bind(&RobotsClient::process_hello, this, std::placeholders::_1),
@@ -324,28 +487,29 @@ namespace bomberman
                 std::bind(&RobotsClient::process_game_ended, this, std::placeholders::_1),
             },
             server_messages_q_.front());
-
-        if (!send_in_progress && !draw_messages_q_.empty())
-        {
-          send_to_gui();
-        }
-
         server_messages_q_.pop();
       }
     }
 
+    // Writes all queued messages to server at once. Messages queued while writing are written together after it.
     void send_to_server()
     {
-      assert(!client_messages_q_.empty());
-      NetSerializer net_serializer;
-      buffer_t buffer = net_serializer.serialize(client_messages_q_.front());
+      if (server_write_in_progress_ || client_messages_q_.empty())
+        return;
+      server_write_buffer_.clear();
+      while (!client_messages_q_.empty())
+      {
+        if (std::holds_alternative<Join>(client_messages_q_.front()))
+          join_queued_ = false;
+        server_serializer_.serialize_append(client_messages_q_.front(), server_write_buffer_);
+        client_messages_q_.pop();
+      }
+      server_write_in_progress_ = true;
       auto after_write_callback = [this](boost::system::error_code ec, std::size_t) {
         if (!ec)
         {
-          // If there is still some message in client_messages_q_ then call send_to_server again.
-          client_messages_q_.pop();
-          if (!client_messages_q_.empty())
-            send_to_server();
+          server_write_in_progress_ = false;
+          send_to_server();
         }
         else
         {
@@ -353,24 +517,228 @@ namespace bomberman
         }
       };
       boost::asio::async_write(server_socket_,
-                               boost::asio::buffer(buffer, buffer.size()),
+                               boost::asio::buffer(server_write_buffer_),
                                after_write_callback);
     }
 
-    void send_to_gui()
+    // --- GUI FRAMES SCHEDULING ---
+    // Turns change the frame and schedule it to be sent when the current burst of server messages is processed,
+    // but not sooner than draw_interval_ after the previous one. Turns processed before that are merged into one frame.
+    void schedule_draw()
     {
-      assert(!draw_messages_q_.empty());
+      if (draw_pending_)
+        return;
+      draw_pending_ = true;
+      // Timer which already expired completes after the handler reading from server yields.
+      draw_timer_.expires_at(std::max(std::chrono::steady_clock::now(), last_draw_ + draw_interval_));
+      draw_timer_.async_wait([this](boost::system::error_code ec) {
+        if (!ec)
+          flush_draw();
+      });
+    }
 
-      while (!draw_messages_q_.empty())
+    // Sends pending game frame now. Called on timer and before lobby, so no game transition is lost.
+    void flush_draw()
+    {
+      if (!draw_pending_)
+        return;
+      draw_pending_ = false;
+      draw_timer_.cancel();
+      game_frame_.set(game_frame_t::TURN, frame_changes_.turn);
+      if (viewport_.has_value())
+      {
+        draw_viewport();
+      }
+      else
       {
-        NetSerializer net_serializer;
-        buffer_t buffer = net_serializer.serialize(draw_messages_q_.front());
-        gui_socket_.send_to(boost::asio::buffer(buffer, buffer.size()),
-                            *gui_endpoints);
-        draw_messages_q_.pop();
+        if (frame_changes_.players_positions)
+          set_frame_positions(nullptr);
+        if (frame_changes_.bombs)
+          game_frame_.set_bombs(game_state_.bombs, frame_changes_.turn, hello_.bomb_timer);
+        game_frame_.set(game_frame_t::EXPLOSIONS, explosions_);
       }
+      if (frame_changes_.scores)
+        game_frame_.set(game_frame_t::SCORES, game_state_.scores);
+      frame_changes_ = frame_changes_t{.turn = frame_changes_.turn};
+      last_draw_ = std::chrono::steady_clock::now();
+      send_to_gui(game_frame_);
     }
 
+    // Robots are shown at predicted position, only those in visible area if it is given.
+    void set_frame_positions(const area_t *visible)
+    {
+      if (!prediction_.has_value() && !visible)
+      {
+        game_frame_.set(game_frame_t::PLAYERS_POSITIONS, game_state_.player_to_position);
+        return;
+      }
+      frame_positions_.clear();
+      for (const auto &[player_id, position] : game_state_.player_to_position)
+      {
+        const position_t shown = prediction_.has_value() && player_id == own_id_ ? prediction_->position : position;
+        if (!visible || visible->contains(shown))
+          frame_positions_.insert({player_id, shown});
+      }
+      game_frame_.set(game_frame_t::PLAYERS_POSITIONS, frame_positions_);
+    }
+    // --- END OF GUI FRAMES SCHEDULING ---
+
+    // --- VIEWPORT ---
+    // In viewport mode frame shows only the part of the board around own robot, or around focus given in
+    // arguments if the client has no robot. The window is extended to whole tiles of block_tiles_, so blocks
+    // of the frame are copied from the tiles in view and moving the window costs as much as the tiles.
+    area_t viewport_window() const
+    {
+      position_t focus = focus_.value_or(position_t{.x = static_cast<uint16_t>(hello_.size_x / 2),
+                                                    .y = static_cast<uint16_t>(hello_.size_y / 2)});
+      if (own_id_.has_value())
+      {
+        if (prediction_.has_value())
+          focus = prediction_->position;
+        else if (auto it = game_state_.player_to_position.find(*own_id_); it != game_state_.player_to_position.end())
+          focus = it->second;
+      }
+      // Window is moved inside the board if focus is close to its edge.
+      const auto axis = [](const uint16_t center, const uint16_t window, const uint16_t board) {
+        const int32_t begin = std::clamp<int32_t>(center - window / 2, 0, std::max<int32_t>(board - window, 0));
+        const int32_t end = std::min<int32_t>(begin + window, board) - 1;
+        return std::pair<uint16_t, uint16_t>(static_cast<uint16_t>(begin), static_cast<uint16_t>(std::max<int32_t>(end, begin)));
+      };
+      const auto [begin_x, end_x] = axis(focus.x, viewport_->first, hello_.size_x);
+      const auto [begin_y, end_y] = axis(focus.y, viewport_->second, hello_.size_y);
+      return area_t{.begin = {begin_x, begin_y}, .end = {end_x, end_y}};
+    }
+
+    void add_viewport_block(const position_t &position)
+    {
+      block_tiles_.add(position);
+      frame_changes_.blocks |= drawn_tiles_.has_value() && drawn_tiles_->contains(block_tiles_t::tile_key(position));
+    }
+
+    void remove_viewport_block(const position_t &position)
+    {
+      block_tiles_.remove(position);
+      frame_changes_.blocks |= drawn_tiles_.has_value() && drawn_tiles_->contains(block_tiles_t::tile_key(position));
+    }
+
+    void draw_viewport()
+    {
+      const area_t tiles = block_tiles_t::covering(viewport_window());
+      if (frame_changes_.blocks || drawn_tiles_ != tiles)
+      {
+        game_frame_.set_blocks(block_tiles_, tiles);
+        drawn_tiles_ = tiles;
+      }
+      constexpr uint16_t tile_size = block_tiles_t::TILE_SIZE;
+      const area_t visible{
+          .begin = {static_cast<uint16_t>(tiles.begin.x * tile_size), static_cast<uint16_t>(tiles.begin.y * tile_size)},
+          .end = {static_cast<uint16_t>(std::min<uint32_t>(tiles.end.x * tile_size + tile_size - 1, UINT16_MAX)),
+                  static_cast<uint16_t>(std::min<uint32_t>(tiles.end.y * tile_size + tile_size - 1, UINT16_MAX))}};
+      // Robots, bombs and explosions are few compared to blocks, they are filtered for every frame.
+      set_frame_positions(&visible);
+      game_frame_.set_bombs(game_state_.bombs, frame_changes_.turn, hello_.bomb_timer, visible);
+      visible_explosions_.clear();
+      for (const position_t &position : explosions_)
+      {
+        if (visible.contains(position))
+          visible_explosions_.insert(position);
+      }
+      game_frame_.set(game_frame_t::EXPLOSIONS, visible_explosions_);
+    }
+    // --- END OF VIEWPORT ---
+
+    // --- GUI OUTPUT ---
+    // Datagrams for GUI wait in gui_backlog_ and are sent without blocking, all waiting ones with one sendmmsg.
+    // If GUI socket is not writable, only the newest game frame after every lobby is kept and the backlog
+    // is bounded, the oldest datagrams are dropped.
+    void send_to_gui(const Lobby &lobby)
+    {
+      gui_datagram_t &datagram = enqueue_gui(false);
+      gui_serializer_.serialize_append(draw_message_t(lobby), datagram.data);
+      send_gui_backlog();
+    }
+
+    void send_to_gui(const game_frame_t &game_frame)
+    {
+      // Game frame which was not sent yet is stale, it is replaced by the new one.
+      gui_datagram_t &datagram = !gui_backlog_.empty() && gui_backlog_.back().game_frame
+                                     ? gui_backlog_.back()
+                                     : enqueue_gui(true);
+      datagram.data.resize(game_frame.size());
+      boost::asio::buffer_copy(boost::asio::buffer(datagram.data), game_frame.buffers());
+      send_gui_backlog();
+    }
+
+    // Adds empty datagram to the backlog, reusing memory of sent ones.
+    gui_datagram_t &enqueue_gui(const bool game_frame)
+    {
+      if (gui_backlog_.size() == GUI_BACKLOG_SIZE)
+      {
+        BOOST_LOG_TRIVIAL(debug) << "GUI backlog full, dropping the oldest datagram";
+        release_gui_datagram();
+      }
+      buffer_t data;
+      if (!free_gui_buffers_.empty())
+      {
+        data = std::move(free_gui_buffers_.back());
+        free_gui_buffers_.pop_back();
+      }
+      data.clear();
+      gui_backlog_.push_back(gui_datagram_t{.data = std::move(data), .game_frame = game_frame});
+      return gui_backlog_.back();
+    }
+
+    void release_gui_datagram()
+    {
+      free_gui_buffers_.push_back(std::move(gui_backlog_.front().data));
+      gui_backlog_.pop_front();
+    }
+
+    void send_gui_backlog()
+    {
+      if (gui_send_waiting_)
+        return;
+      while (!gui_backlog_.empty())
+      {
+        const std::size_t count = std::min(gui_backlog_.size(), GUI_BATCH_SIZE);
+        std::array<iovec, GUI_BATCH_SIZE> iovecs;
+        std::array<mmsghdr, GUI_BATCH_SIZE> headers{};
+        for (std::size_t i = 0; i < count; i++)
+        {
+          buffer_t &data = gui_backlog_[i].data;
+          iovecs[i] = iovec{.iov_base = data.data(), .iov_len = data.size()};
+          headers[i].msg_hdr.msg_name = gui_endpoint_.data();
+          headers[i].msg_hdr.msg_namelen = static_cast<socklen_t>(gui_endpoint_.size());
+          headers[i].msg_hdr.msg_iov = &iovecs[i];
+          headers[i].msg_hdr.msg_iovlen = 1;
+        }
+        const int sent = ::sendmmsg(gui_socket_.native_handle(), headers.data(), static_cast<unsigned int>(count), 0);
+        if (sent < 0)
+        {
+          if (errno == EAGAIN || errno == EWOULDBLOCK)
+          {
+            // Continue when GUI socket is writable again, new datagrams are queued meanwhile.
+            gui_send_waiting_ = true;
+            gui_socket_.async_wait(boost::asio::ip::udp::socket::wait_write,
+                                   [this](boost::system::error_code ec) {
+                                     gui_send_waiting_ = false;
+                                     if (ec)
+                                       throw SendError("GUI", ec);
+                                     send_gui_backlog();
+                                   });
+            return;
+          }
+          if (errno == EINTR)
+            continue;
+          boost::system::error_code ec(errno, boost::asio::error::get_system_category());
+          throw SendError("GUI", ec);
+        }
+        for (int i = 0; i < sent; i++)
+          release_gui_datagram();
+      }
+    }
+    // --- END OF GUI OUTPUT ---
+
     ~RobotsClient()
     {
       server_socket_.close();
@@ -394,9 +762,56 @@ namespace bomberman
     std::queue<input_message_t> input_messages_q_;
     std::queue<client_message_t> client_messages_q_;
     std::queue<server_message_t> server_messages_q_;
-    std::queue<draw_message_t> draw_messages_q_;
+    NetSerializer server_serializer_;
+    buffer_t server_write_buffer_;
+    bool server_write_in_progress_ = false;
+    bool join_queued_ = false;
+    // Set when a turn of the current game was processed, its number is game_state_.turn.
+    bool turn_processed_ = false;
+    // Inputs are merged per turn, see handle_gui_message.
+    bool input_sent_this_turn_ = false;
+    bool predict_;
+    std::optional<player_id_t> own_id_;
+    // Move sent in turn, which takes own robot from one position to the other.
+    struct prediction_t
+    {
+      position_t from;
+      direction_t direction;
+      position_t position;
+      turn_t turn;
+    };
+    // Move reaches the server in one of this many turns after the one in which it was sent.
+    static constexpr turn_t PREDICTION_TURNS = 2;
+    std::optional<prediction_t> prediction_;
+    player_to_position_t frame_positions_;
+    std::optional<std::pair<uint16_t, uint16_t>> viewport_;
+    std::optional<position_t> focus_;
+    block_tiles_t block_tiles_;
+    std::optional<area_t> drawn_tiles_;
+    explosions_t visible_explosions_;
+    NetSerializer gui_serializer_;
+    static constexpr std::size_t GUI_BACKLOG_SIZE = 64;
+    static constexpr std::size_t GUI_BATCH_SIZE = 16;
+    boost::asio::ip::udp::endpoint gui_endpoint_;
+    std::deque<gui_datagram_t> gui_backlog_;
+    std::vector<buffer_t> free_gui_buffers_;
+    bool gui_send_waiting_ = false;
     Hello hello_;
     game_state_t game_state_;
+    game_frame_t game_frame_;
+    // Parts of game frame changed by turns which were not sent yet.
+    struct frame_changes_t
+    {
+      turn_t turn = 0;
+      bool players_positions = false, bombs = false, scores = false;
+      // Blocks in viewport tiles changed.
+      bool blocks = false;
+    } frame_changes_;
+    explosions_t explosions_;
+    bool draw_pending_ = false;
+    boost::asio::steady_timer draw_timer_;
+    std::chrono::milliseconds draw_interval_;
+    std::chrono::steady_clock::time_point last_draw_;
   };
 
   robots_client_args_t get_client_arguments(int ac, char *av[])
@@ -407,6 +822,14 @@ namespace bomberman
         "<(host):(port) or (IPv4):(port) or (IPv6):(port)>")(
         "-n", boost::program_options::value<std::string>(), "player name (max 255 characters)")(
         "-p", boost::program_options::value<uint32_t>(), "port number")(
+        "-i", boost::program_options::value<uint32_t>()->default_value(0),
+        "minimal interval between game frames sent to GUI in milliseconds, 0 sends one after every burst of turns")(
+        "-m", boost::program_options::bool_switch()->default_value(false),
+        "predict movement of own robot before server confirms it")(
+        "-w", boost::program_options::value<std::string>(),
+        "<width>x<height> of the part of the board around own robot sent to GUI")(
+        "-f", boost::program_options::value<std::string>(),
+        "<x>,<y> center of that part when client has no robot")(
         "-s", boost::program_options::value<std::string>(),
         "<(host):(port) or (IPv4):(port) or (IPv6):(port)>");
 
@@ -434,6 +857,20 @@ namespace bomberman
         throw InvalidArguments("port must be unsigned 16-bits integer!");
       else
         args.port = static_cast<uint16_t>(port);
+      args.draw_interval = std::chrono::milliseconds(vm["-i"].as<uint32_t>());
+      args.predict = vm["-m"].as<bool>();
+      if (vm.count("-w"))
+      {
+        auto [width, height] = parse_pair(vm["-w"].as<std::string>(), 'x');
+        if (width == 0 || height == 0)
+          throw InvalidArguments("viewport must not be empty");
+        args.viewport = {width, height};
+      }
+      if (vm.count("-f"))
+      {
+        auto [x, y] = parse_pair(vm["-f"].as<std::string>(), ',');
+        args.focus = position_t{.x = x, .y = y};
+      }
 
       if (args.player_name.length() > 255)
         throw InvalidArguments("player name must be shorter than 256 characters");
@@ -443,7 +880,10 @@ namespace bomberman
                                << ", gui_endpoint_input: "
                                << args.gui_endpoint_input
                                << ", player_name: " << args.player_name
-                               << ", port: " << args.port;
+                               << ", port: " << args.port
+                               << ", draw_interval: " << args.draw_interval.count() << "ms"
+                               << ", predict: " << args.predict
+                               << ", viewport: " << (args.viewport ? std::to_string(args.viewport->first) + "x" + std::to_string(args.viewport->second) : "whole board");
 
       return args;
     }
@@ -1,9 +1,13 @@
 #ifndef BOMBER_COMMON_H
 #define BOMBER_COMMON_H
 
+#include "board.h"
 #include "types.h"
 #include "messages.h"
 
+#include <algorithm>
+#include <array>
+#include <optional>
 #include <unordered_set>
 
 namespace bomberman
@@ -12,6 +16,9 @@ namespace bomberman
     struct game_state_t
     {
         game_state_t(){reset();}
+        // Bombs are placed and exploded all game long, their nodes come from given resource.
+        explicit game_state_t(std::pmr::memory_resource *bombs_resource)
+            : bombs(bombs_resource) { reset(); }
 
         players_t players;
         blocks_t blocks;
@@ -33,54 +40,155 @@ namespace bomberman
         }
     };
 
-    explosions_t calculate_explosion_range(const position_t bomb_position, const explosion_radius_t explosion_radius,
-                                                             const size_x_t size_x, const size_y_t size_y,
-                                                             const blocks_t blocks)
+    // Returns position moved by distance cells in given direction. Caller makes sure it stays on the board.
+    position_t shift_position(position_t position, const direction_t direction, const uint16_t distance)
     {
-        explosions_t result;
+        switch (direction)
+        {
+        case direction_t::Up:
+            position.y += distance;
+            break;
+        case direction_t::Right:
+            position.x += distance;
+            break;
+        case direction_t::Down:
+            position.y -= distance;
+            break;
+        case direction_t::Left:
+            position.x -= distance;
+            break;
+        }
+        return position;
+    }
 
-        for (auto sign : {-1, 1})
+    // Returns robot position after moving in given direction, or nothing if it would leave the board or enter a block.
+    std::optional<position_t> calculate_move(position_t position, const direction_t direction, const blocks_t &blocks)
+    {
+        int32_t x = static_cast<int32_t>(position.x);
+        int32_t y = static_cast<int32_t>(position.y);
+        switch (direction)
         {
-            bool x_exp_blocked = false, y_exp_blocked = false;
-            for (size_x_t i = 0; i <= explosion_radius; i++)
-            {
-                if (!x_exp_blocked)
-                {
-                    x_exp_blocked = true;
-                    if(bomb_position.x + sign * i >= 0 && bomb_position.x + sign * i < size_x)
-                    {
-                        size_x_t x_i = sign > 0 ? bomb_position.x + i : bomb_position.x - i;
-                        position_t current_pos{
-                            .x = x_i,
-                            .y = bomb_position.y,
-                        };
-                        result.insert(current_pos);
-                        if (!blocks.contains(current_pos))
-                            x_exp_blocked = false;
-                    }
-                }
-            }
-            for (size_y_t i = 0; i <= explosion_radius; i++)
+        case bomberman::direction_t::Up:
+            y++;
+            break;
+        case bomberman::direction_t::Right:
+            x++;
+            break;
+        case bomberman::direction_t::Down:
+            y--;
+            break;
+        case bomberman::direction_t::Left:
+            x--;
+            break;
+        };
+
+        if (x < 0 || y < 0 || x >= blocks.size_x() || y >= blocks.size_y())
+            return {};
+        position.x = static_cast<size_x_t>(x);
+        position.y = static_cast<size_y_t>(y);
+        if (blocks.contains(position))
+            return {};
+        else
+            return position;
+    }
+
+    // Cross shaped explosion: bomb position and how many cells explosion reaches in each direction.
+    // Explosion stops at the first block (block itself is still in range) or at the board edge.
+    struct explosion_t
+    {
+        static constexpr std::array<direction_t, 4> DIRECTIONS{direction_t::Up, direction_t::Right, direction_t::Down, direction_t::Left};
+
+        position_t center;
+        std::array<uint16_t, 4> reach;
+
+        uint16_t reach_in(const direction_t direction) const noexcept
+        {
+            return reach[static_cast<std::size_t>(direction)];
+        }
+
+        bool contains(const position_t &position) const noexcept
+        {
+            const bool in_row = position.y == center.y &&
+                                position.x + reach_in(direction_t::Left) >= center.x &&
+                                position.x <= center.x + reach_in(direction_t::Right);
+            const bool in_column = position.x == center.x &&
+                                   position.y + reach_in(direction_t::Down) >= center.y &&
+                                   position.y <= center.y + reach_in(direction_t::Up);
+            return in_row || in_column;
+        }
+
+        // Calls f for the last cell of every ray, each cell once. Only these cells (and the center, which
+        // is the last cell of zero length rays) can hold blocks destroyed by this explosion.
+        template <typename F>
+        void for_each_ray_end(F f) const
+        {
+            bool center_visited = false;
+            for (direction_t direction : DIRECTIONS)
             {
-                if (!y_exp_blocked)
+                if (reach_in(direction) == 0)
                 {
-                    y_exp_blocked = true;
-                    if (bomb_position.y + sign * i >= 0 && bomb_position.y + sign * i < size_y)
-                    {
-                        size_y_t y_i = sign > 0 ? bomb_position.y + i : bomb_position.y - i;
-                        position_t current_pos
-                        {
-                            .x = bomb_position.x,
-                            .y = y_i,
-                        };
-                        result.insert(current_pos);
-                        if (!blocks.contains(current_pos))
-                            y_exp_blocked = false;
-                    }
+                    if (center_visited)
+                        continue;
+                    center_visited = true;
                 }
+                f(shift_position(center, direction, reach_in(direction)));
             }
         }
 
+        // Calls f(player_id) for every player standing in range, each one once.
+        template <typename F>
+        void for_each_player(const occupancy_t &occupancy, F f) const
+        {
+            occupancy.for_each_in_row(center.y,
+                                      static_cast<size_x_t>(center.x - reach_in(direction_t::Left)),
+                                      static_cast<size_x_t>(center.x + reach_in(direction_t::Right)), f);
+            // Center was already visited with the row.
+            if (reach_in(direction_t::Down))
+                occupancy.for_each_in_column(center.x,
+                                             static_cast<size_y_t>(center.y - reach_in(direction_t::Down)),
+                                             static_cast<size_y_t>(center.y - 1), f);
+            if (reach_in(direction_t::Up))
+                occupancy.for_each_in_column(center.x,
+                                             static_cast<size_y_t>(center.y + 1),
+                                             static_cast<size_y_t>(center.y + reach_in(direction_t::Up)), f);
+        }
+
+        // Calls f for every cell in range, center is visited once.
+        template <typename F>
+        void for_each_cell(F f) const
+        {
+            f(center);
+            for (direction_t direction : DIRECTIONS)
+                for (uint16_t i = 1; i <= reach_in(direction); i++)
+                    f(shift_position(center, direction, i));
+        }
+    };
+
+    explosion_t calculate_explosion(const position_t bomb_position, const explosion_radius_t explosion_radius,
+                                    const blocks_t &blocks)
+    {
+        explosion_t result;
+        result.center = bomb_position;
+        result.reach.fill(0);
+        // Bomb outside of the board can only come from invalid server data.
+        if (bomb_position.x >= blocks.size_x() || bomb_position.y >= blocks.size_y())
+            return result;
+
+        // Rays can not leave the board.
+        const std::array<std::size_t, 4> edge_distance{
+            static_cast<std::size_t>(blocks.size_y() - 1 - bomb_position.y),
+            static_cast<std::size_t>(blocks.size_x() - 1 - bomb_position.x),
+            static_cast<std::size_t>(bomb_position.y),
+            static_cast<std::size_t>(bomb_position.x),
+        };
+
+        for (direction_t direction : explosion_t::DIRECTIONS)
+        {
+            const std::size_t i = static_cast<std::size_t>(direction);
+            const std::size_t limit = std::min<std::size_t>(explosion_radius, edge_distance[i]);
+            result.reach[i] = static_cast<uint16_t>(blocks.distance_to_block(bomb_position, direction, limit));
+        }
+
         return result;
     }
 }
@@ -0,0 +1,351 @@
+#ifndef BOMBERMAN_ENGINE_H
+#define BOMBERMAN_ENGINE_H
+
+#include "common.h"
+
+#include <algorithm>
+#include <cassert>
+#include <memory_resource>
+#include <optional>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+namespace bomberman
+{
+
+    // What server does with a connection whose outbound queue is over the high-watermark.
+    enum class slow_consumer_policy_t
+    {
+        // Close the connection.
+        Disconnect,
+        // Skip turns sent to spectators, players are still disconnected. Once spectator drains its backlog
+        // it gets GameStarted and the game so far again, at the latest before GameEnded.
+        DropSpectatorTurns,
+    };
+
+    struct robots_server_args_t
+    {
+        bomb_timer_t bomb_timer;
+        players_count_t players_count;
+        turn_duration_t turn_duration;
+        explosion_radius_t explosion_radius;
+        uint16_t initial_blocks;
+        game_length_t game_length;
+        std::string server_name;
+        uint16_t port;
+        uint32_t seed;
+        size_x_t size_x;
+        size_y_t size_y;
+        // Empty if games are not recorded.
+        std::string record_path;
+        std::size_t outbound_high_watermark = 1 << 20;
+        slow_consumer_policy_t slow_consumer_policy = slow_consumer_policy_t::Disconnect;
+        // Size of tiles of interest regions of players, 0 sends every turn whole to everyone.
+        uint16_t interest_tile = 0;
+        // Late joiners get a snapshot of the game instead of all its turns, see snapshot_turns.
+        bool snapshot_catch_up = false;
+    };
+
+    // Messages received from players during one turn, at most one per player.
+    using player_inputs_t = std::unordered_map<player_id_t, client_message_t>;
+
+    // Timing wheel of bombs keyed by the turn in which they explode. Every live bomb explodes within
+    // bomb_timer turns, so bomb_timer slots are enough and turn only touches bombs exploding in it.
+    class bomb_wheel_t
+    {
+    public:
+        explicit bomb_wheel_t(const bomb_timer_t bomb_timer)
+            : slots_(std::max<std::size_t>(1, bomb_timer)) {}
+
+        void schedule(const bomb_id_t bomb_id, const uint32_t explosion_turn)
+        {
+            slots_[explosion_turn % slots_.size()].push_back(bomb_id);
+        }
+
+        // Bombs exploding in given turn. Caller clears the slot after processing it.
+        std::vector<bomb_id_t> &exploding_in(const uint32_t turn)
+        {
+            return slots_[turn % slots_.size()];
+        }
+
+        void clear()
+        {
+            for (auto &slot : slots_)
+                slot.clear();
+        }
+
+    private:
+        std::vector<std::vector<bomb_id_t>> slots_;
+    };
+
+    // Memory for containers built while processing one turn. Allocation moves a pointer in one buffer
+    // and reset() frees everything at once. When a turn does not fit, the buffer grows to hold it, so
+    // after the first turns the arena does not call the global allocator anymore.
+    class turn_arena_t
+    {
+    public:
+        explicit turn_arena_t(const std::size_t initial_size = 64 * 1024)
+            : buffer_(initial_size)
+        {
+            resource_.emplace(buffer_.data(), buffer_.size(), &overflow_);
+        }
+
+        std::pmr::memory_resource *resource() { return &resource_.value(); }
+
+        // Containers allocated in the arena must be destroyed before.
+        void reset()
+        {
+            resource_->release();
+            if (overflow_.allocated)
+            {
+                const std::size_t size = 2 * (buffer_.size() + overflow_.allocated);
+                resource_.reset();
+                buffer_ = std::vector<std::byte>(size);
+                resource_.emplace(buffer_.data(), buffer_.size(), &overflow_);
+                overflow_.allocated = 0;
+            }
+        }
+
+    private:
+        // Upstream of the buffer, counts memory that did not fit in it.
+        struct overflow_resource_t : std::pmr::memory_resource
+        {
+            std::size_t allocated = 0;
+
+            void *do_allocate(std::size_t bytes, std::size_t alignment) override
+            {
+                allocated += bytes;
+                return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+            }
+
+            void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override
+            {
+                std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+            }
+
+            bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+            {
+                return this == &other;
+            }
+        };
+
+        std::vector<std::byte> buffer_;
+        overflow_resource_t overflow_;
+        std::optional<std::pmr::monotonic_buffer_resource> resource_;
+    };
+
+    // Game rules without any I/O or timers. Engine seeded with the same seed, started with the same
+    // players and stepped with the same inputs produces the same events. Random generator is seeded
+    // once, so consecutive games of one engine differ like consecutive games of one server.
+    // Events returned by start_game and step live in the turn arena of the engine and must be
+    // destroyed (or copied) before the next call.
+    class GameEngine
+    {
+    public:
+        explicit GameEngine(const robots_server_args_t &args)
+            : args_(args),
+              state_(&bombs_memory_),
+              random_(args.seed),
+              bomb_wheel_(args.bomb_timer)
+        {
+            state_.blocks.resize(args_.size_x, args_.size_y);
+        }
+
+        const robots_server_args_t &args() const { return args_; }
+        const game_state_t &state() const { return state_; }
+
+        // Game ends after the turn with number game_length.
+        bool finished() const { return state_.turn == args_.game_length; }
+
+        // Places players and initial blocks, returns events of turn 0.
+        events_t start_game(const players_t &players)
+        {
+            // All variables should be zeroed in reset()
+            assert(state_.blocks.size() == 0);
+            assert(state_.bombs.size() == 0);
+            assert(state_.player_to_position.size() == 0);
+            assert(state_.scores.size() == 0);
+
+            state_.players = players;
+            arena_.reset();
+            events_t events(arena_.resource());
+
+            // Generate random players positions and set their scores to zero.
+            for (auto &[player_id, _] : state_.players)
+            {
+                position_t player_position = random_position();
+                state_.player_to_position.insert({player_id, player_position});
+                players_occupancy_.insert(player_id, player_position);
+                state_.scores[player_id] = 0;
+                events.push_back(PlayerMoved(player_id, player_position));
+            }
+
+            // Generate random blocks
+            for (auto i = 0; i < args_.initial_blocks; i++)
+            {
+                position_t block_position = random_position();
+                // Add BlockPlaced only if the block has really been placed
+                if (state_.blocks.insert(block_position))
+                {
+                    events.push_back(BlockPlaced(block_position));
+                }
+            }
+
+            return events;
+        }
+
+        // Processes one turn and returns its events. Number of this turn is state().turn afterwards.
+        events_t step(const player_inputs_t &inputs)
+        {
+            arena_.reset();
+            robots_destroyed_t robots_destroyed(arena_.resource());
+            blocks_destroyed_t blocks_destroyed(arena_.resource());
+            events_t events(arena_.resource());
+
+            process_bombs(robots_destroyed, blocks_destroyed, events);
+            process_players(inputs, robots_destroyed, events);
+            // Add scores to players whose rob was destroyed.
+            for (auto player_id : robots_destroyed)
+                state_.scores[player_id]++;
+
+            ++state_.turn;
+            return events;
+        }
+
+        // Clears game state after the game ended.
+        void reset()
+        {
+            state_.reset();
+            players_occupancy_.clear();
+            bomb_wheel_.clear();
+        }
+
+    private:
+        position_t random_position()
+        {
+            return position_t{
+                .x = static_cast<size_x_t>(random_() % (long unsigned int)args_.size_x),
+                .y = static_cast<size_y_t>(random_() % (long unsigned int)args_.size_y),
+            };
+        }
+
+        void process_bombs(robots_destroyed_t &robots_destroyed, blocks_destroyed_t &blocks_destroyed, events_t &events)
+        {
+            // Calculate effects of bombs exploding in this turn.
+            std::vector<bomb_id_t> &exploding = bomb_wheel_.exploding_in(state_.turn + 1);
+            for (const bomb_id_t bomb_id : exploding)
+            {
+                const placed_bomb_t &bomb = state_.bombs.at(bomb_id);
+                events.push_bomb_exploded(bomb_id);
+                const explosion_t explosion = calculate_explosion(bomb.position, args_.explosion_radius, state_.blocks);
+                // Rays stop at the first block, so blocks can only be destroyed at their ends.
+                auto destroy_block = [&](const position_t &position)
+                {
+                    if (state_.blocks.contains(position))
+                    {
+                        blocks_destroyed.insert(position);
+                        events.add_block_destroyed(position);
+                    }
+                };
+                explosion.for_each_ray_end(destroy_block);
+                auto destroy_robot = [&](const player_id_t player_id)
+                {
+                    robots_destroyed.insert(player_id);
+                    events.add_robot_destroyed(player_id);
+                };
+                explosion.for_each_player(players_occupancy_, destroy_robot);
+            }
+
+            for (const bomb_id_t bomb_id : exploding)
+                state_.bombs.erase(bomb_id);
+            exploding.clear();
+            for (const auto &block_position : blocks_destroyed)
+                state_.blocks.erase(block_position);
+        }
+
+        // Updates player position together with spatial index of players.
+        void set_player_position(const player_id_t player_id, const position_t &position)
+        {
+            position_t &player_position = state_.player_to_position.at(player_id);
+            players_occupancy_.move(player_id, player_position, position);
+            player_position = position;
+        }
+
+        void process_player_turn(events_t &events, const player_id_t player_id, const client_message_t &client_message)
+        {
+            std::visit(overloaded{// Join message, ignore in game
+                                  [](const Join &) {},
+                                  // PlaceBomb message
+                                  [player_id, &events, this](const PlaceBomb &)
+                                  {
+                                      const bomb_id_t bomb_id = state_.free_bomb_id++;
+                                      placed_bomb_t bomb{
+                                          .position = state_.player_to_position[player_id],
+                                          .placed_turn = static_cast<turn_t>(state_.turn + 1),
+                                      };
+                                      state_.bombs.insert({bomb_id, bomb});
+                                      // Bomb with zero timer would explode after its timer wraps around, which is longer than any game.
+                                      if (args_.bomb_timer)
+                                          bomb_wheel_.schedule(bomb_id, static_cast<uint32_t>(bomb.placed_turn) + args_.bomb_timer);
+                                      events.push_back(BombPlaced(bomb_id, bomb.position));
+                                  },
+                                  // PlaceBlock message
+                                  [player_id, &events, this](const PlaceBlock &)
+                                  {
+                                      position_t block_position = state_.player_to_position[player_id];
+                                      if (state_.blocks.insert(block_position))
+                                      {
+                                          events.push_back(BlockPlaced(block_position));
+                                      }
+                                  },
+                                  // Move message
+                                  [player_id, &events, this](const Move &move)
+                                  {
+                                      position_t position = state_.player_to_position[player_id];
+                                      auto new_position = calculate_move(position, move.direction, state_.blocks);
+                                      if (new_position)
+                                      {
+                                          set_player_position(player_id, new_position.value());
+                                          events.push_back(PlayerMoved(player_id, new_position.value()));
+                                      }
+                                  }},
+                       client_message);
+        }
+
+        void process_players(const player_inputs_t &inputs, robots_destroyed_t &robots_destroyed, events_t &events)
+        {
+            for (auto &[player_id, player] : state_.players)
+            {
+                if (!robots_destroyed.contains(player_id))
+                {
+                    auto player_message_it = inputs.find(player_id);
+                    if (player_message_it != inputs.end())
+                    {
+                        process_player_turn(events, player_id, player_message_it->second);
+                    }
+                }
+                else
+                {
+                    position_t player_new_position = random_position();
+                    set_player_position(player_id, player_new_position);
+                    events.push_back(PlayerMoved(player_id, player_new_position));
+                }
+            }
+        }
+
+        const robots_server_args_t args_;
+        // Nodes of exploded bombs are reused for new ones.
+        std::pmr::unsynchronized_pool_resource bombs_memory_;
+        game_state_t state_;
+        occupancy_t players_occupancy_;
+        std::minstd_rand random_;
+        bomb_wheel_t bomb_wheel_;
+        turn_arena_t arena_;
+    };
+
+} // namespace bomberman
+
+#endif // BOMBERMAN_ENGINE_H
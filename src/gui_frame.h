@@ -0,0 +1,305 @@
+#ifndef BOMBERMAN_GUI_FRAME_H
+#define BOMBERMAN_GUI_FRAME_H
+
+#include "messages.h"
+#include "position_set.h"
+#include "schema.h"
+#include "types.h"
+
+#include <boost/asio.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+namespace bomberman
+{
+
+    // Rectangle of cells from begin to end, both inclusive.
+    struct area_t
+    {
+        position_t begin, end;
+
+        bool contains(const position_t &position) const noexcept
+        {
+            return begin.x <= position.x && position.x <= end.x && begin.y <= position.y && position.y <= end.y;
+        }
+
+        bool operator==(const area_t &other) const noexcept = default;
+    };
+
+    // Blocks grouped in square tiles of the board. Every tile keeps its blocks encoded as entries of blocks
+    // list, so the list of blocks of any group of tiles is put together by copying their entries.
+    class block_tiles_t
+    {
+    public:
+        static constexpr uint16_t TILE_SIZE = 32;
+
+        void clear()
+        {
+            tiles_.clear();
+            tile_index_.clear();
+            block_index_.clear();
+        }
+
+        // Caller adds only blocks which are not added yet.
+        void add(const position_t &position)
+        {
+            tile_t &tile = tile_of(position);
+            block_index_.insert(position, static_cast<uint32_t>(tile.blocks.size()));
+            tile.blocks.push_back(position);
+            const std::size_t offset = tile.entries.size();
+            tile.entries.resize(offset + BLOCK_SIZE);
+            char *out = tile.entries.data() + offset;
+            wire::encode(position, out);
+        }
+
+        void remove(const position_t &position)
+        {
+            uint32_t *index = block_index_.find(position);
+            if (!index)
+                return;
+            tile_t &tile = tile_of(position);
+            const uint32_t last = static_cast<uint32_t>(tile.blocks.size() - 1);
+            if (*index != last)
+            {
+                // The last entry of the tile takes place of removed one.
+                char *out = tile.entries.data() + *index * BLOCK_SIZE;
+                wire::encode(tile.blocks[last], out);
+                tile.blocks[*index] = tile.blocks[last];
+                *block_index_.find(tile.blocks[last]) = *index;
+            }
+            tile.blocks.pop_back();
+            tile.entries.resize(tile.entries.size() - BLOCK_SIZE);
+            block_index_.erase(position);
+        }
+
+        // Coordinates of tile holding position.
+        static position_t tile_key(const position_t &position) noexcept
+        {
+            return position_t{.x = static_cast<uint16_t>(position.x / TILE_SIZE),
+                              .y = static_cast<uint16_t>(position.y / TILE_SIZE)};
+        }
+
+        // Smallest area made of whole tiles which covers given one.
+        static area_t covering(const area_t &area) noexcept
+        {
+            return area_t{.begin = tile_key(area.begin), .end = tile_key(area.end)};
+        }
+
+        // Encodes list of blocks of tiles in area returned by covering().
+        void encode(const area_t &tiles, buffer_t &section) const
+        {
+            std::size_t count = 0;
+            for_each_tile(tiles, [&count](const tile_t &tile)
+                          { count += tile.blocks.size(); });
+            section.resize(sizeof(list_len_t) + count * BLOCK_SIZE);
+            char *out = section.data();
+            wire::encode(static_cast<list_len_t>(count), out);
+            for_each_tile(tiles, [&out](const tile_t &tile)
+                          {
+                              std::memcpy(out, tile.entries.data(), tile.entries.size());
+                              out += tile.entries.size(); });
+        }
+
+    private:
+        static constexpr std::size_t BLOCK_SIZE = wire::fixed_size<position_t>();
+
+        struct tile_t
+        {
+            std::vector<position_t> blocks;
+            buffer_t entries;
+        };
+
+        tile_t &tile_of(const position_t &position)
+        {
+            const auto [index, inserted] = tile_index_.insert(tile_key(position), static_cast<uint32_t>(tiles_.size()));
+            if (inserted)
+                tiles_.emplace_back();
+            return tiles_[*index];
+        }
+
+        template <typename F>
+        void for_each_tile(const area_t &tiles, F f) const
+        {
+            for (uint32_t x = tiles.begin.x; x <= tiles.end.x; x++)
+            {
+                for (uint32_t y = tiles.begin.y; y <= tiles.end.y; y++)
+                {
+                    const uint32_t *index = tile_index_.find(position_t{.x = static_cast<uint16_t>(x), .y = static_cast<uint16_t>(y)});
+                    if (index)
+                        f(tiles_[*index]);
+                }
+            }
+        }
+
+        // Tiles are never removed during the game, empty tile stays for the next blocks.
+        std::vector<tile_t> tiles_;
+        position_map_t<uint32_t> tile_index_;
+        // Index of block in blocks of its tile.
+        position_map_t<uint32_t> block_index_;
+    };
+
+    // Encoded Game message for the GUI, kept from turn to turn. Every part of the message is encoded in its
+    // own section and only sections changed by the turn are encoded again, buffers() gives them in order of
+    // the message. Blocks are updated in place: their section is a list of fixed size entries, placed
+    // block is appended and destroyed one is overwritten by the last entry, so a turn costs as much as its
+    // events and not as the whole board.
+    class game_frame_t
+    {
+    public:
+        enum section_t
+        {
+            HEADER, // message code, server name, size and game length
+            TURN,
+            PLAYERS,
+            PLAYERS_POSITIONS,
+            BLOCKS,
+            BOMBS,
+            EXPLOSIONS,
+            SCORES,
+            SECTIONS_COUNT
+        };
+
+        using buffers_t = std::array<boost::asio::const_buffer, SECTIONS_COUNT>;
+
+        // Encodes parts which do not change during the game and empties the rest.
+        void start(const Hello &hello, const players_t &players)
+        {
+            buffer_t &header = sections_[HEADER];
+            header.resize(sizeof(message_code_t) + wire::encoded_size(hello.server_name) + sizeof(size_x_t) +
+                          sizeof(size_y_t) + sizeof(game_length_t));
+            char *out = header.data();
+            wire::encode(static_cast<message_code_t>(draw_message_code_t::Game), out);
+            wire::encode(hello.server_name, out);
+            wire::encode(hello.size_x, out);
+            wire::encode(hello.size_y, out);
+            wire::encode(hello.game_length, out);
+
+            set(TURN, turn_t{0});
+            set(PLAYERS, players);
+            set(PLAYERS_POSITIONS, player_to_position_t{});
+            set(BOMBS, bomb_list_t{});
+            set(EXPLOSIONS, explosions_t{});
+            set(SCORES, scores_t{});
+            blocks_.clear();
+            block_index_.clear();
+            set(BLOCKS, blocks_);
+        }
+
+        // Encodes value as the whole section.
+        template <class T>
+        void set(const section_t section, const T &value)
+        {
+            assert(section != HEADER);
+            buffer_t &buffer = sections_[section];
+            buffer.resize(wire::encoded_size(value));
+            char *out = buffer.data();
+            wire::encode(value, out);
+        }
+
+        // Bombs are encoded straight from game state, their timers are counted for given turn.
+        void set_bombs(const bombs_t &bombs, const turn_t turn, const bomb_timer_t bomb_timer)
+        {
+            buffer_t &buffer = sections_[BOMBS];
+            buffer.resize(sizeof(list_len_t) + bombs.size() * wire::fixed_size<bomb_t>());
+            char *out = buffer.data();
+            wire::encode(static_cast<list_len_t>(bombs.size()), out);
+            for (const auto &[_, bomb] : bombs)
+                wire::encode(bomb_t{.position = bomb.position, .timer = bomb.timer_at(turn, bomb_timer)}, out);
+        }
+
+        // Only bombs in area.
+        void set_bombs(const bombs_t &bombs, const turn_t turn, const bomb_timer_t bomb_timer, const area_t &area)
+        {
+            const std::size_t count = std::count_if(bombs.begin(), bombs.end(), [&area](const auto &entry)
+                                                    { return area.contains(entry.second.position); });
+            buffer_t &buffer = sections_[BOMBS];
+            buffer.resize(sizeof(list_len_t) + count * wire::fixed_size<bomb_t>());
+            char *out = buffer.data();
+            wire::encode(static_cast<list_len_t>(count), out);
+            for (const auto &[_, bomb] : bombs)
+            {
+                if (area.contains(bomb.position))
+                    wire::encode(bomb_t{.position = bomb.position, .timer = bomb.timer_at(turn, bomb_timer)}, out);
+            }
+        }
+
+        // Blocks of the frame come from tiles instead of add_block and remove_block.
+        void set_blocks(const block_tiles_t &block_tiles, const area_t &tiles)
+        {
+            block_tiles.encode(tiles, sections_[BLOCKS]);
+        }
+
+        // Caller adds only blocks which are not in the frame yet.
+        void add_block(const position_t &position)
+        {
+            buffer_t &buffer = sections_[BLOCKS];
+            const bool inserted [[maybe_unused]] = block_index_.insert(position, static_cast<uint32_t>(blocks_.size())).second;
+            assert(inserted);
+            blocks_.push_back(position);
+            const std::size_t offset = buffer.size();
+            buffer.resize(offset + BLOCK_SIZE);
+            char *out = buffer.data() + offset;
+            wire::encode(position, out);
+            write_blocks_count();
+        }
+
+        void remove_block(const position_t &position)
+        {
+            uint32_t *index = block_index_.find(position);
+            if (!index)
+                return;
+            buffer_t &buffer = sections_[BLOCKS];
+            const uint32_t last = static_cast<uint32_t>(blocks_.size() - 1);
+            if (*index != last)
+            {
+                // The last entry takes place of removed one.
+                char *out = buffer.data() + sizeof(list_len_t) + *index * BLOCK_SIZE;
+                wire::encode(blocks_[last], out);
+                blocks_[*index] = blocks_[last];
+                *block_index_.find(blocks_[last]) = *index;
+            }
+            blocks_.pop_back();
+            block_index_.erase(position);
+            buffer.resize(buffer.size() - BLOCK_SIZE);
+            write_blocks_count();
+        }
+
+        std::size_t size() const noexcept
+        {
+            std::size_t result = 0;
+            for (const buffer_t &section : sections_)
+                result += section.size();
+            return result;
+        }
+
+        // Sections in message order, valid until the frame is changed.
+        buffers_t buffers() const noexcept
+        {
+            buffers_t result;
+            for (std::size_t i = 0; i < SECTIONS_COUNT; i++)
+                result[i] = boost::asio::buffer(sections_[i]);
+            return result;
+        }
+
+    private:
+        static constexpr std::size_t BLOCK_SIZE = wire::fixed_size<position_t>();
+
+        void write_blocks_count()
+        {
+            char *out = sections_[BLOCKS].data();
+            wire::encode(static_cast<list_len_t>(blocks_.size()), out);
+        }
+
+        std::array<buffer_t, SECTIONS_COUNT> sections_;
+        // Blocks in order of their entries in the blocks section and index of entry of every block.
+        std::vector<position_t> blocks_;
+        position_map_t<uint32_t> block_index_;
+    };
+
+} // namespace bomberman
+
+#endif // BOMBERMAN_GUI_FRAME_H
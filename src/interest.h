@@ -0,0 +1,276 @@
+#ifndef BOMBERMAN_INTEREST_H
+#define BOMBERMAN_INTEREST_H
+
+#include "position_set.h"
+#include "types.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <map>
+#include <optional>
+#include <vector>
+
+namespace bomberman
+{
+
+    // Set of player ids, one bit for every possible id.
+    class players_mask_t
+    {
+    public:
+        void set(const player_id_t player_id) noexcept { words_[player_id / 64] |= uint64_t{1} << (player_id % 64); }
+        void reset(const player_id_t player_id) noexcept { words_[player_id / 64] &= ~(uint64_t{1} << (player_id % 64)); }
+
+        bool test(const player_id_t player_id) const noexcept
+        {
+            return words_[player_id / 64] >> (player_id % 64) & 1;
+        }
+
+        players_mask_t &operator|=(const players_mask_t &other) noexcept
+        {
+            for (std::size_t i = 0; i < words_.size(); i++)
+                words_[i] |= other.words_[i];
+            return *this;
+        }
+
+        bool none() const noexcept
+        {
+            return std::all_of(words_.begin(), words_.end(), [](const uint64_t word)
+                               { return word == 0; });
+        }
+
+        // Calls f with every id in the set.
+        template <typename F>
+        void for_each(F f) const
+        {
+            for (std::size_t i = 0; i < words_.size(); i++)
+            {
+                for (uint64_t word = words_[i]; word; word &= word - 1)
+                    f(static_cast<player_id_t>(i * 64 + std::countr_zero(word)));
+            }
+        }
+
+    private:
+        std::array<uint64_t, 4> words_{};
+    };
+
+    // Spatial index of interest regions of players, used to send every player only the events near its robot.
+    // Board is divided into square tiles, region of a player is the tile of its robot and the tiles around it.
+    // Every tile keeps the set of players whose region covers it, so players interested in an event are found
+    // with one lookup. Cells of every tile where blocks were placed or destroyed and turns in which players
+    // stopped watching tiles are kept too, so a player coming back to a tile learns only what it missed. Block
+    // changes older than every such turn are pruned.
+    class interest_index_t
+    {
+    public:
+        // Tile which became part of region of a player, with turn in which the player stopped watching it before.
+        struct new_tile_t
+        {
+            position_t tile;
+            std::optional<turn_t> left_turn;
+        };
+
+        interest_index_t(const uint16_t tile_size, const size_x_t size_x, const size_y_t size_y)
+            : tile_size_(std::max<uint16_t>(1, tile_size)),
+              tiles_x_(static_cast<uint16_t>((size_x + tile_size_ - 1) / tile_size_)),
+              tiles_y_(static_cast<uint16_t>((size_y + tile_size_ - 1) / tile_size_)),
+              left_(std::numeric_limits<player_id_t>::max() + 1) {}
+
+        uint16_t tile_size() const noexcept { return tile_size_; }
+
+        position_t tile_of(const position_t &position) const noexcept
+        {
+            return position_t{.x = static_cast<uint16_t>(position.x / tile_size_),
+                              .y = static_cast<uint16_t>(position.y / tile_size_)};
+        }
+
+        // Centers region of player at tile of position in given turn. Returns tiles which were not in the region before.
+        std::vector<new_tile_t> move(const player_id_t player_id, const position_t &position, const turn_t turn)
+        {
+            const position_t center = tile_of(position);
+            std::optional<position_t> &old_center = centers_[player_id];
+            if (old_center == center)
+                return {};
+            std::vector<new_tile_t> new_tiles;
+            if (old_center.has_value())
+            {
+                for_each_region_tile(*old_center, [&](const position_t &tile)
+                                     {
+                                         unsubscribe(tile, player_id);
+                                         if (!near(center, tile))
+                                         {
+                                             left_[player_id].insert(tile, turn);
+                                             left_turns_[turn]++;
+                                         } });
+            }
+            for_each_region_tile(center, [&](const position_t &tile)
+                                 {
+                                     subscribers_[tile].set(player_id);
+                                     if (!old_center.has_value() || !near(*old_center, tile))
+                                     {
+                                         // Turn is not in use anymore, changes since it are still kept until the next prune.
+                                         std::optional<turn_t> left_turn;
+                                         if (const turn_t *turn = left_[player_id].find(tile))
+                                         {
+                                             left_turn = *turn;
+                                             forget_left_turn(*turn);
+                                             left_[player_id].erase(tile);
+                                         }
+                                         new_tiles.push_back(new_tile_t{.tile = tile, .left_turn = left_turn});
+                                     } });
+            old_center = center;
+            return new_tiles;
+        }
+
+        // Block was placed or destroyed at position in given turn. Turns come in order.
+        void block_changed(const position_t &position, const turn_t turn)
+        {
+            const auto [index, inserted] = changes_index_.insert(tile_of(position), static_cast<uint32_t>(changes_.size()));
+            if (inserted)
+                changes_.emplace_back();
+            changes_[*index].push_back(block_change_t{.turn = turn, .position = position});
+            changes_count_++;
+        }
+
+        // Drops block changes from before the oldest turn in which some player left a tile it does not watch
+        // again yet, or all of them if there is no such turn. Tiles are swept only when the number of changes
+        // doubled since the last sweep, so a call costs amortized constant time per change.
+        void prune(const turn_t current_turn)
+        {
+            if (changes_count_ < std::max<std::size_t>(MIN_CHANGES_TO_PRUNE, 2 * changes_after_prune_))
+                return;
+            const turn_t oldest = left_turns_.empty() ? current_turn : left_turns_.begin()->first;
+            changes_count_ = 0;
+            for (std::vector<block_change_t> &changes : changes_)
+            {
+                auto it = std::lower_bound(changes.begin(), changes.end(), oldest, [](const block_change_t &change, const turn_t turn)
+                                           { return change.turn < turn; });
+                changes.erase(changes.begin(), it);
+                changes_count_ += changes.size();
+            }
+            changes_after_prune_ = changes_count_;
+        }
+
+        // Player is not watching anything anymore, so turns in which it left tiles are not in use.
+        void remove(const player_id_t player_id)
+        {
+            std::optional<position_t> &center = centers_[player_id];
+            if (center.has_value())
+            {
+                for_each_region_tile(*center, [&](const position_t &tile)
+                                     { unsubscribe(tile, player_id); });
+                center.reset();
+            }
+            if (left_[player_id].empty())
+                return;
+            for (const auto &[tile, turn] : left_[player_id])
+                forget_left_turn(turn);
+            left_[player_id].clear();
+        }
+
+        // Calls f with every cell of tile where block changed since given turn, including it. Cell changed
+        // many times is given many times.
+        template <typename F>
+        void for_each_changed_since(const position_t &tile, const turn_t turn, F f) const
+        {
+            const uint32_t *index = changes_index_.find(tile);
+            if (!index)
+                return;
+            const std::vector<block_change_t> &changes = changes_[*index];
+            auto it = std::lower_bound(changes.begin(), changes.end(), turn, [](const block_change_t &change, const turn_t turn)
+                                       { return change.turn < turn; });
+            for (; it != changes.end(); ++it)
+                f(it->position);
+        }
+
+        void clear()
+        {
+            subscribers_.clear();
+            centers_.fill(std::nullopt);
+            for (position_map_t<turn_t> &left : left_)
+                left.clear();
+            left_turns_.clear();
+            changes_index_.clear();
+            changes_.clear();
+            changes_count_ = 0;
+            changes_after_prune_ = 0;
+        }
+
+        // Players whose region covers position.
+        const players_mask_t &interested(const position_t &position) const noexcept
+        {
+            static const players_mask_t nobody;
+            const players_mask_t *mask = subscribers_.find(tile_of(position));
+            return mask ? *mask : nobody;
+        }
+
+        bool is_interested(const player_id_t player_id, const position_t &position) const noexcept
+        {
+            return centers_[player_id].has_value() && near(*centers_[player_id], tile_of(position));
+        }
+
+    private:
+        static constexpr std::size_t MIN_CHANGES_TO_PRUNE = 1024;
+
+        static bool near(const position_t &center, const position_t &tile) noexcept
+        {
+            return std::abs(center.x - tile.x) <= 1 && std::abs(center.y - tile.y) <= 1;
+        }
+
+        template <typename F>
+        void for_each_region_tile(const position_t &center, F f) const
+        {
+            for (int32_t x = center.x - 1; x <= center.x + 1; x++)
+            {
+                for (int32_t y = center.y - 1; y <= center.y + 1; y++)
+                {
+                    if (x >= 0 && y >= 0 && x < tiles_x_ && y < tiles_y_)
+                        f(position_t{.x = static_cast<uint16_t>(x), .y = static_cast<uint16_t>(y)});
+                }
+            }
+        }
+
+        void unsubscribe(const position_t &tile, const player_id_t player_id)
+        {
+            players_mask_t *mask = subscribers_.find(tile);
+            if (!mask)
+                return;
+            mask->reset(player_id);
+            if (mask->none())
+                subscribers_.erase(tile);
+        }
+
+        void forget_left_turn(const turn_t turn)
+        {
+            auto it = left_turns_.find(turn);
+            if (--it->second == 0)
+                left_turns_.erase(it);
+        }
+
+        struct block_change_t
+        {
+            turn_t turn;
+            position_t position;
+        };
+
+        uint16_t tile_size_;
+        uint16_t tiles_x_, tiles_y_;
+        position_map_t<players_mask_t> subscribers_;
+        std::array<std::optional<position_t>, 256> centers_;
+        // For every player, tiles it stopped watching and turn in which it happened, and number of such
+        // tiles for every turn.
+        std::vector<position_map_t<turn_t>> left_;
+        std::map<turn_t, std::size_t> left_turns_;
+        // Block changes in every tile in order of turns, with their number now and after the last prune.
+        position_map_t<uint32_t> changes_index_;
+        std::vector<std::vector<block_change_t>> changes_;
+        std::size_t changes_count_ = 0;
+        std::size_t changes_after_prune_ = 0;
+    };
+
+} // namespace bomberman
+
+#endif // BOMBERMAN_INTEREST_H
@@ -1,6 +1,7 @@
 #ifndef BOMBERMAN_MESSAGES_H
 #define BOMBERMAN_MESSAGES_H
 
+#include "board.h"
 #include "types.h"
 
 #include <boost/asio.hpp>
@@ -93,6 +94,9 @@ namespace bomberman
         Turn(){};
         Turn(turn_t _turn, events_t &_events)
             : turn(_turn), events(_events) {}
+        // Takes events with their memory, without copying them.
+        Turn(turn_t _turn, events_t &&_events)
+            : turn(_turn), events(std::move(_events)) {}
         turn_t turn;
         events_t events;
     };
@@ -134,7 +138,7 @@ namespace bomberman
         players_t players;
         player_positions_t players_positions;
         blocks_t blocks;
-        bombs_t bombs;
+        bomb_list_t bombs;
         explosions_t explosions;
         scores_t scores;
     };
@@ -3,10 +3,13 @@
 
 #include "errors.h"
 #include "messages.h"
+#include "schema.h"
 
 #include <boost/asio.hpp>
 #include <boost/asio/spawn.hpp>
 
+#include <algorithm>
+#include <cstring>
 #include <functional>
 #include <optional>
 
@@ -37,14 +40,13 @@ namespace bomberman
         T decode_number()
         {
             T result;
-            if constexpr (sizeof(T) == 1)
-                result = std::bit_cast<T>((uint8_t) * (buffer.data() + read_idx));
-            else if constexpr (sizeof(T) == 2)
-                result = std::bit_cast<T>(ntohs(*std::bit_cast<uint16_t *>(buffer.data() + read_idx)));
+            std::memcpy(&result, buffer.data() + read_idx, sizeof(T));
+            if constexpr (sizeof(T) == 2)
+                result = std::bit_cast<T>(ntohs(std::bit_cast<uint16_t>(result)));
             else if constexpr (sizeof(T) == 4)
-                result = std::bit_cast<T>(ntohl(*std::bit_cast<uint32_t *>(buffer.data() + read_idx)));
+                result = std::bit_cast<T>(ntohl(std::bit_cast<uint32_t>(result)));
             else
-                assert(false);
+                static_assert(sizeof(T) == 1);
 
             read_idx += sizeof(T);
             return result;
@@ -65,238 +67,94 @@ namespace bomberman
     };
 
     // Class for reading and deserializing from tcp stream.
-    // It uses coroutines to wait for next TCP data chunk.
+    // It reads whatever is available into its buffer and parses messages from it, so coroutine waits
+    // for the next TCP data chunk only when the message being parsed is incomplete. Bytes of following
+    // messages stay in the buffer for the next call.
     class TcpDeserializer : public NetDeserializer<boost::asio::ip::tcp::socket>
     {
     public:
+        static constexpr std::size_t READ_CHUNK = 64 * 1024;
+
         explicit TcpDeserializer(boost::asio::ip::tcp::socket &socket)
-            : NetDeserializer(socket) {}
+            : NetDeserializer(socket) { buffer.resize(READ_CHUNK); }
 
         message_t auto get_server_message(boost::asio::yield_context yield)
         {
-            reset_state();
-            server_message_code_t message_code = get_number<server_message_code_t>(yield);
-            BOOST_LOG_TRIVIAL(debug) << "received server message code: " << static_cast<uint16_t>(message_code);
-            switch (message_code)
-            {
-            case server_message_code_t::Hello:
-                return get_hello_message(yield);
-            case server_message_code_t::AcceptedPlayer:
-                return get_accepted_player_message(yield);
-            case server_message_code_t::GameStarted:
-                return get_game_started_message(yield);
-            case server_message_code_t::Turn:
-                return get_turn_message(yield);
-            case server_message_code_t::GameEnded:
-                return get_game_ended_message(yield);
-            default:
-                BOOST_LOG_TRIVIAL(fatal) << "Invalid server message code!";
-                throw InvalidMessage("Server");
-            }
+            server_message_t message;
+            source_t source{*this, yield, "Server"};
+            wire::decode(message, source);
+            BOOST_LOG_TRIVIAL(debug) << "received server message code: " << message.index();
+            return message;
         }
 
         message_t auto get_client_message(boost::asio::yield_context yield)
         {
-            reset_state();
-            client_message_code_t message_code = get_number<client_message_code_t>(yield);
-            BOOST_LOG_TRIVIAL(debug) << "received client message code: " << static_cast<uint16_t>(message_code);
-            switch (message_code)
-            {
-            case client_message_code_t::Join:
-                return get_join(yield);
-            case client_message_code_t::PlaceBomb:
-                return get_place_bomb();
-            case client_message_code_t::PlaceBlock:
-                return get_place_block();
-            case client_message_code_t::Move:
-                return get_move(yield);
-            default:
-                BOOST_LOG_TRIVIAL(fatal) << "Invalid client message code!";
-                throw InvalidMessage("Client");
-            }
+            client_message_t message;
+            source_t source{*this, yield, "Client"};
+            wire::decode(message, source);
+            BOOST_LOG_TRIVIAL(debug) << "received client message code: " << message.index();
+            return message;
         }
 
     private:
-        // Read n bytes from TCP stream. Handles buffer resizing and write index shifting.
-        void read_n_bytes(std::size_t read_n, boost::asio::yield_context yield)
-        {
-            buffer.resize(buffer.size() + read_n);
-            boost::system::error_code ec;
-            std::size_t read_count = boost::asio::async_read(socket_, boost::asio::buffer(buffer.data() + write_idx, read_n), yield[ec]);
-            if (ec || read_count != read_n)
-            {
-                BOOST_LOG_TRIVIAL(debug) << "Error in TcpDeserializer::read_n_bytes " << ec.message();
-                throw ReceiveError("Server", ec);
-            }
-            write_idx += read_n;
-        }
-
-        template <typename T>
-        T get_number(boost::asio::yield_context yield)
-        {
-            std::size_t read_n = sizeof(T);
-            read_n_bytes(read_n, yield);
-            return decode_number<T>();
-        }
-
-        // Reads and decodes string in specified format. Works with UTF-8.
-        std::string get_string(boost::asio::yield_context yield)
-        {
-            str_len_t str_len = get_number<str_len_t>(yield);
-            read_n_bytes(static_cast<std::size_t>(str_len), yield);
-            std::string result;
-            while (read_idx < write_idx)
-                result.push_back(buffer[read_idx++]);
-            return result;
-        }
-
-        player_t get_player(boost::asio::yield_context yield)
+        // Source of bytes for wire::decode, waits for data in coroutine.
+        struct source_t
         {
-            return player_t{
-                .name = get_string(yield),
-                .address = get_string(yield),
-            };
-        }
+            TcpDeserializer &deserializer;
+            boost::asio::yield_context &yield;
+            const char *from;
 
-        event_t get_event(boost::asio::yield_context yield)
-        {
-            event_code_t event_code = get_number<event_code_t>(yield);
-            if (event_code == event_code_t::BombPlaced)
-            {
-                BombPlaced bomb_placed;
-                bomb_placed.bomb_id = get_number<bomb_id_t>(yield);
-                bomb_placed.position = {
-                    .x = get_number<size_x_t>(yield),
-                    .y = get_number<size_y_t>(yield),
-                };
-                return bomb_placed;
-            }
-            else if (event_code == event_code_t::BombExploded)
-            {
-                BombExploded bomb_exploded;
-                bomb_exploded.bomb_id = get_number<bomb_id_t>(yield);
-                list_len_t rob_dest_list_len = get_number<list_len_t>(yield);
-                while (rob_dest_list_len--)
-                {
-                    bomb_exploded.robots_destroyed.insert(get_number<player_id_t>(yield));
-                }
-                list_len_t block_dest_list_len = get_number<list_len_t>(yield);
-                while (block_dest_list_len--)
-                {
-                    bomb_exploded.blocks_destroyed.insert(
-                        position_t{
-                            .x = get_number<size_x_t>(yield),
-                            .y = get_number<size_y_t>(yield),
-                        });
-                }
-                return bomb_exploded;
-            }
-            else if (event_code == event_code_t::PlayerMoved)
+            void ensure(std::size_t n)
             {
-                PlayerMoved player_moved;
-                player_moved.player_id = get_number<player_id_t>(yield);
-                player_moved.position = {
-                    .x = get_number<size_x_t>(yield),
-                    .y = get_number<size_y_t>(yield),
-                };
-                return player_moved;
-            }
-            else if (event_code == event_code_t::BlockPlaced)
-            {
-                BlockPlaced block_placed;
-                block_placed.position = {
-                    .x = get_number<size_x_t>(yield),
-                    .y = get_number<size_y_t>(yield),
-                };
-                return block_placed;
+                deserializer.read_n_bytes(n, yield);
             }
 
-            BOOST_LOG_TRIVIAL(fatal) << "invalid event code :  " << static_cast<std::underlying_type<event_code_t>::type>(event_code);
-            throw InvalidMessage("Server");
-        }
-
-        server_message_t get_hello_message(boost::asio::yield_context yield)
-        {
-            Hello hello;
-            hello.server_name = get_string(yield);
-            hello.players_count = get_number<players_count_t>(yield);
-            hello.size_x = get_number<size_x_t>(yield);
-            hello.size_y = get_number<size_y_t>(yield);
-            hello.game_length = get_number<game_length_t>(yield);
-            hello.explosion_radius = get_number<explosion_radius_t>(yield);
-            hello.bomb_timer = get_number<bomb_timer_t>(yield);
-
-            return hello;
-        }
-
-        server_message_t get_accepted_player_message(boost::asio::yield_context yield)
-        {
-            AcceptedPlayer accepted_player;
-            accepted_player.player_id = get_number<player_id_t>(yield);
-            accepted_player.player = get_player(yield);
-            return accepted_player;
-        }
-        server_message_t get_game_started_message(boost::asio::yield_context yield)
-        {
-            GameStarted game_started;
-            map_len_t map_len = get_number<map_len_t>(yield);
-            while (map_len--)
+            template <typename T>
+            T number()
             {
-                game_started.players.insert({get_number<player_id_t>(yield),
-                                             get_player(yield)});
+                ensure(sizeof(T));
+                return deserializer.decode_number<T>();
             }
-            return game_started;
-        }
-        server_message_t get_turn_message(boost::asio::yield_context yield)
-        {
-            Turn turn;
-            turn.turn = get_number<turn_t>(yield);
-            list_len_t event_list_len = get_number<list_len_t>(yield);
-            while (event_list_len--)
+
+            const char *bytes(std::size_t n)
             {
-                turn.events.push_back(get_event(yield));
+                ensure(n);
+                const char *result = deserializer.buffer.data() + deserializer.read_idx;
+                deserializer.read_idx += n;
+                return result;
             }
-            return turn;
-        }
-        server_message_t get_game_ended_message(boost::asio::yield_context yield)
-        {
-            GameEnded game_ended;
-            map_len_t scores_map_len = get_number<map_len_t>(yield);
-            while (scores_map_len--)
-            {
 
-                game_ended.scores.insert({
-                    get_number<player_id_t>(yield),
-                    get_number<score_t>(yield),
-                });
+            [[noreturn]] void invalid()
+            {
+                BOOST_LOG_TRIVIAL(fatal) << "Invalid " << from << " message!";
+                throw InvalidMessage(from);
             }
-            return game_ended;
-        }
+        };
 
-        client_message_t get_join(boost::asio::yield_context yield)
+        // Makes sure at least n unread bytes are in buffer, reading from TCP stream only if they are not.
+        // Unread bytes are moved to the front of buffer first, so buffer grows only for huge fields.
+        void read_n_bytes(std::size_t read_n, boost::asio::yield_context &yield)
         {
-            Join join;
-            join.name = get_string(yield);
-            return join;
-        }
-
-        client_message_t get_place_bomb()
-        {
-            PlaceBomb place_bomb;
-            return place_bomb;
-        }
+            if (write_idx - read_idx >= read_n)
+                return;
 
-        client_message_t get_place_block()
-        {
-            PlaceBlock place_block;
-            return place_block;
-        }
+            std::memmove(buffer.data(), buffer.data() + read_idx, write_idx - read_idx);
+            write_idx -= read_idx;
+            read_idx = 0;
+            if (buffer.size() < read_n)
+                buffer.resize(std::max(read_n, 2 * buffer.size()));
 
-        client_message_t get_move(boost::asio::yield_context yield)
-        {
-            Move move;
-            move.direction = get_number<direction_t>(yield);
-            return move;
+            while (write_idx < read_n)
+            {
+                boost::system::error_code ec;
+                std::size_t read_count = socket_.async_read_some(boost::asio::buffer(buffer.data() + write_idx, buffer.size() - write_idx), yield[ec]);
+                if (ec)
+                {
+                    BOOST_LOG_TRIVIAL(debug) << "Error in TcpDeserializer::read_n_bytes " << ec.message();
+                    throw ReceiveError("Server", ec);
+                }
+                write_idx += read_count;
+            }
         }
     };
 
@@ -333,36 +191,21 @@ namespace bomberman
                 return;
             }
 
+            // Datagram must hold exactly one valid message.
             std::optional<input_message_t> input_message;
-            auto message_code = decode_number<input_message_code_t>();
-            BOOST_LOG_TRIVIAL(debug) << "GUI message code: " << static_cast<uint16_t>(message_code);
-            switch (message_code)
+            try
             {
-            case input_message_code_t::PlaceBomb:
-                if (write_idx != 1)
-                {
-                    BOOST_LOG_TRIVIAL(debug) << "invalid message length for input_message_code_t::PlaceBomb, write_idx =" << write_idx;
-                    break;
-                }
-                input_message = PlaceBomb{};
-                break;
-            case input_message_code_t::PlaceBlock:
-                if (write_idx != 1)
-                {
-                    BOOST_LOG_TRIVIAL(debug) << "invalid message length for input_message_code_t::PlaceBlock, write_idx =" << write_idx;
-                    break;
-                }
-                input_message = PlaceBlock{};
-                break;
-            case input_message_code_t::Move:
-                auto direction = decode_number<direction_t>();
-                if (write_idx != 2 || direction > direction_t::Left)
-                {
-                    BOOST_LOG_TRIVIAL(debug) << "invalid message for input_message_code_t::Move, write_idx =" << write_idx << ", direction = " << static_cast<std::underlying_type<direction_t>::type>(direction);
-                    break;
-                }
-                input_message = Move{direction};
-                break;
+                input_message_t message;
+                source_t source{*this};
+                wire::decode(message, source);
+                if (read_idx != write_idx)
+                    source.invalid();
+                input_message = message;
+                BOOST_LOG_TRIVIAL(debug) << "GUI message code: " << message.index();
+            }
+            catch (InvalidMessage &)
+            {
+                BOOST_LOG_TRIVIAL(debug) << "invalid message from GUI, length = " << write_idx;
             }
 
             reset_state();
@@ -377,280 +220,100 @@ namespace bomberman
         }
 
     private:
+        // Source of bytes for wire::decode, limited to the received datagram.
+        struct source_t
+        {
+            UdpDeserializer &deserializer;
+
+            void ensure(std::size_t n)
+            {
+                if (deserializer.write_idx - deserializer.read_idx < n)
+                    invalid();
+            }
+
+            template <typename T>
+            T number()
+            {
+                ensure(sizeof(T));
+                return deserializer.decode_number<T>();
+            }
+
+            const char *bytes(std::size_t n)
+            {
+                ensure(n);
+                const char *result = deserializer.buffer.data() + deserializer.read_idx;
+                deserializer.read_idx += n;
+                return result;
+            }
+
+            [[noreturn]] void invalid()
+            {
+                throw InvalidMessage("GUI");
+            }
+        };
+
         boost::asio::ip::udp::endpoint gui_endpoint;
     };
 
     // Class for serializing data in specific format.
+    // Exact size of every message is computed first, then the message is encoded with bulk copies into
+    // storage of that size: internal buffer, buffer given by caller or any memory given as pointer.
+    // Wire layout comes from schema.h.
     class NetSerializer
     {
     public:
         NetSerializer() {}
-        // #TODO!
-        buffer_t &serialize(client_message_t &client_message)
-        {
-            reset_state();
-            std::visit(overloaded{
-                           std::bind(&NetSerializer::write_join, this, std::placeholders::_1),
-                           std::bind(&NetSerializer::write_place_bomb, this, std::placeholders::_1),
-                           std::bind(&NetSerializer::write_place_block, this, std::placeholders::_1),
-                           std::bind(&NetSerializer::write_move, this, std::placeholders::_1),
-                       },
-                       client_message);
-
-            return buffer;
-        }
-        buffer_t &serialize(server_message_t &server_message)
-        {
-            reset_state();
-            std::visit(overloaded{
-                           std::bind(&NetSerializer::write_hello, this, std::placeholders::_1),
-                           std::bind(&NetSerializer::write_accepted_player, this, std::placeholders::_1),
-                           std::bind(&NetSerializer::write_game_started, this, std::placeholders::_1),
-                           std::bind(&NetSerializer::write_turn, this, std::placeholders::_1),
-                           std::bind(&NetSerializer::write_game_ended, this, std::placeholders::_1)},
-                       server_message);
 
-            return buffer;
-        }
-        buffer_t &serialize(draw_message_t &draw_message)
+        // Encodes message into internal buffer, which is reused by the next call.
+        template <class M>
+        buffer_t &serialize(const M &message)
         {
-            reset_state();
-            std::visit(overloaded{
-                           std::bind(&NetSerializer::write_lobby, this, std::placeholders::_1),
-                           std::bind(&NetSerializer::write_game, this, std::placeholders::_1),
-                       },
-                       draw_message);
+            buffer.resize(encoded_size(message));
+            encode(message, buffer.data());
             return buffer;
         }
-        buffer_t &serialize(targeted_message_t &targeted_message)
-        {
-            reset_state();
-            std::visit(overloaded{
-                           [this](target_one_t &target_one) { serialize(target_one.message); },
-                           [this](target_all_t &target_all) { serialize(target_all.message); },
-                       },
-                       targeted_message);
-            return buffer;
-        }
-
-    private:
-        buffer_t buffer;
-
-        void reset_state()
-        {
-            buffer.resize(0);
-        }
-
-        // Writes number in net order to buffer.
-        template <typename T>
-        void write_number(T number)
-        {
-            if constexpr (sizeof(T) == 1)
-                number = number;
-            else if constexpr (sizeof(T) == 2)
-                number = std::bit_cast<T>(htons(std::bit_cast<uint16_t>(number)));
-            else if constexpr (sizeof(T) == 4)
-                number = std::bit_cast<T>(htonl(std::bit_cast<uint32_t>(number)));
-            else
-                assert(false);
-
-            char *bytes = std::bit_cast<char *>(&number);
-            write_bytes_to_buffer(bytes, sizeof(T));
-        }
-
-        // Resize and write bytes to buffer
-        void write_bytes_to_buffer(const char *bytes, std::size_t length)
-        {
-            assert(bytes);
-            for (std::size_t i = 0; i < length; i++)
-                buffer.push_back(bytes[i]);
-        }
 
-        void write_string(const std::string &s)
+        // Appends encoded message to storage.
+        template <class M>
+        void serialize_append(const M &message, buffer_t &storage)
         {
-            write_number((str_len_t)s.size());
-            for (auto i = s.begin(); i != s.end(); i++)
-                buffer.push_back(*i);
+            const std::size_t offset = storage.size();
+            storage.resize(offset + encoded_size(message));
+            encode(message, storage.data() + offset);
         }
 
-        void write_player(const player_t &player)
+        // Writes exactly encoded_size(message) bytes starting at out, returns end of written bytes.
+        template <class M>
+        static char *encode(const M &message, char *out)
         {
-            write_string(player.name);
-            write_string(player.address);
+            wire::encode(message, out);
+            return out;
         }
 
-        void write_position(const position_t &position)
+        static char *encode(const targeted_message_t &targeted_message, char *out)
         {
-            write_number<size_x_t>(position.x);
-            write_number<size_y_t>(position.y);
+            return std::visit([out](const auto &target)
+                              { return encode(target.message, out); },
+                              targeted_message);
         }
 
-        void write_bomb(const bomb_t &bomb)
+        template <class M>
+        static std::size_t encoded_size(const M &message)
         {
-            write_position(bomb.position);
-            write_number<bomb_timer_t>(bomb.timer);
+            return wire::encoded_size(message);
         }
 
-        void write_join(Join &join)
+        static std::size_t encoded_size(const targeted_message_t &targeted_message)
         {
-            write_number<client_message_code_t>(client_message_code_t::Join);
-            write_string(join.name);
+            return std::visit([](const auto &target)
+                              { return wire::encoded_size(target.message); },
+                              targeted_message);
         }
 
-        void write_place_bomb(PlaceBomb &)
-        {
-            write_number<client_message_code_t>(client_message_code_t::PlaceBomb);
-        }
-
-        void write_place_block(PlaceBlock &)
-        {
-            write_number<client_message_code_t>(client_message_code_t::PlaceBlock);
-        }
-
-        void write_move(Move &move)
-        {
-            write_number<client_message_code_t>(client_message_code_t::Move);
-            write_number<direction_t>(move.direction);
-        }
-
-        void write_lobby(Lobby &lobby)
-        {
-            write_number<draw_message_code_t>(draw_message_code_t::Lobby);
-            write_string(lobby.server_name);
-            write_number<players_count_t>(lobby.players_count);
-            write_number<size_x_t>(lobby.size_x);
-            write_number<size_y_t>(lobby.size_y);
-            write_number<game_length_t>(lobby.game_length);
-            write_number<explosion_radius_t>(lobby.explosion_radius);
-            write_number<bomb_timer_t>(lobby.bomb_timer);
-            write_number<map_len_t>((map_len_t)lobby.players.size());
-            std::for_each(lobby.players.begin(), lobby.players.end(),
-                          [this](auto &players_map_entry) {
-                              write_number<player_id_t>(players_map_entry.first);
-                              write_player(players_map_entry.second);
-                          });
-        }
-
-        void write_game(Game &game)
-        {
-            write_number<draw_message_code_t>(draw_message_code_t::Game);
-            write_string(game.server_name);
-            write_number<size_x_t>(game.size_x);
-            write_number<size_y_t>(game.size_y);
-            write_number<game_length_t>(game.game_length);
-            write_number<turn_t>(game.turn);
-            write_number<map_len_t>((map_len_t)game.players.size());
-            std::for_each(game.players.begin(), game.players.end(),
-                          [this](auto &players_map_entry) {
-                              write_number<player_id_t>(players_map_entry.first);
-                              write_player(players_map_entry.second);
-                          });
-            write_number<map_len_t>((map_len_t)game.players_positions.size());
-            std::for_each(game.players_positions.begin(), game.players_positions.end(),
-                          [this](auto &players_positions_map_entry) {
-                              write_number<player_id_t>(players_positions_map_entry.first);
-                              write_position(players_positions_map_entry.second);
-                          });
-            write_number<list_len_t>((list_len_t)game.blocks.size());
-            std::for_each(game.blocks.begin(), game.blocks.end(),
-                          [this](auto &block) {
-                              write_position(block);
-                          });
-            write_number<list_len_t>((list_len_t)game.bombs.size());
-            std::for_each(game.bombs.begin(), game.bombs.end(),
-                          [this](auto &bomb_pair) {
-                              write_bomb(bomb_pair.second);
-                          });
-            write_number<list_len_t>((list_len_t)game.explosions.size());
-            std::for_each(game.explosions.begin(), game.explosions.end(),
-                          [this](auto &explosion) {
-                              write_position(explosion);
-                          });
-            write_number<map_len_t>((map_len_t)game.scores.size());
-            for (auto &scores_map_entry : game.scores)
-            {
-                write_number<player_id_t>(scores_map_entry.first);
-                write_number<score_t>(scores_map_entry.second);
-            }
-        }
-
-        void write_hello(Hello &hello)
-        {
-            write_number<server_message_code_t>(server_message_code_t::Hello);
-            write_string(hello.server_name);
-            write_number<players_count_t>(hello.players_count);
-            write_number<size_x_t>(hello.size_x);
-            write_number<size_y_t>(hello.size_y);
-            write_number<game_length_t>(hello.game_length);
-            write_number<explosion_radius_t>(hello.explosion_radius);
-            write_number<bomb_timer_t>(hello.bomb_timer);
-        }
-
-        void write_accepted_player(AcceptedPlayer &accepted_player)
-        {
-            write_number<server_message_code_t>(server_message_code_t::AcceptedPlayer);
-            write_number<player_id_t>(accepted_player.player_id);
-            write_player(accepted_player.player);
-        }
-
-        void write_game_started(GameStarted &game_started)
-        {
-            write_number<server_message_code_t>(server_message_code_t::GameStarted);
-            write_number<map_len_t>((map_len_t)game_started.players.size());
-            for (auto &players_map_entry : game_started.players)
-            {
-                write_number<player_id_t>(players_map_entry.first);
-                write_player(players_map_entry.second);
-            }
-        }
-
-        void write_turn(Turn &turn)
-        {
-            write_number<server_message_code_t>(server_message_code_t::Turn);
-            write_number<turn_t>(turn.turn);
-            write_number<list_len_t>((list_len_t)turn.events.size());
-            for (event_t &event : turn.events)
-            {
-                std::visit(overloaded{[this](BombPlaced &bomb_placed) {
-                                          write_number<event_code_t>(event_code_t::BombPlaced);
-                                          write_number<bomb_id_t>(bomb_placed.bomb_id);
-                                          write_position(bomb_placed.position);
-                                      },
-                                      [this](BombExploded &bomb_exploded) {
-                                          write_number<event_code_t>(event_code_t::BombExploded);
-                                          write_number<bomb_id_t>(bomb_exploded.bomb_id);
-                                          write_number<list_len_t>((list_len_t)bomb_exploded.robots_destroyed.size());
-                                          for (const player_id_t &player_id : bomb_exploded.robots_destroyed)
-                                              write_number<player_id_t>(player_id);
-                                          write_number<list_len_t>((list_len_t)bomb_exploded.blocks_destroyed.size());
-                                          for (const position_t &block_pos : bomb_exploded.blocks_destroyed)
-                                              write_position(block_pos);
-                                      },
-                                      [this](PlayerMoved &player_moved) {
-                                          write_number<event_code_t>(event_code_t::PlayerMoved);
-                                          write_number<player_id_t>(player_moved.player_id);
-                                          write_position(player_moved.position);
-                                      },
-                                      [this](BlockPlaced &block_placed) {
-                                          write_number<event_code_t>(event_code_t::BlockPlaced);
-                                          write_position(block_placed.position);
-                                      }},
-                           event);
-            }
-        }
-
-        void write_game_ended(GameEnded &game_ended)
-        {
-            write_number<server_message_code_t>(server_message_code_t::GameEnded);
-            write_number<map_len_t>((map_len_t)game_ended.scores.size());
-            for (auto &scores_map_entry : game_ended.scores)
-            {
-                write_number<player_id_t>(scores_map_entry.first);
-                write_number<score_t>(scores_map_entry.second);
-            }
-        }
+    private:
+        buffer_t buffer;
     };
 
 } // namespace bomberman
 
-#endif // BOMBERMAN_NET_H
\ No newline at end of file
+#endif // BOMBERMAN_NET_H
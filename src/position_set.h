@@ -0,0 +1,301 @@
+#ifndef BOMBERMAN_POSITION_SET_H
+#define BOMBERMAN_POSITION_SET_H
+
+#include "types.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <iterator>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+namespace bomberman
+{
+
+    // Open addressing hash map keyed by position packed into 32 bits. Slots are one contiguous array
+    // probed linearly from the mixed hash of the key. Erase shifts following slots back instead of
+    // leaving tombstones, so lookups do not get slower after many erases. Capacity is a power of two
+    // and at most 3/4 of slots are used.
+    template <class Value>
+    class position_map_t
+    {
+        struct slot_t
+        {
+            uint32_t key;
+            bool full;
+            [[no_unique_address]] Value value;
+        };
+
+        // Iterator over slot_t or const slot_t, dereferences to pair of position and reference to value.
+        template <class Slot>
+        class basic_iterator
+        {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = std::pair<position_t, decltype((std::declval<Slot &>().value))>;
+            using difference_type = std::ptrdiff_t;
+            using reference = value_type;
+
+            basic_iterator() : slots_(nullptr), idx_(0), end_(0) {}
+            basic_iterator(Slot *slots, std::size_t idx, std::size_t end)
+                : slots_(slots), idx_(idx), end_(end) { skip_empty(); }
+
+            position_t position() const noexcept { return position_t::unpacked(slots_[idx_].key); }
+            auto &value() const noexcept { return slots_[idx_].value; }
+            reference operator*() const noexcept { return {position(), value()}; }
+
+            basic_iterator &operator++() noexcept
+            {
+                ++idx_;
+                skip_empty();
+                return *this;
+            }
+
+            basic_iterator operator++(int) noexcept
+            {
+                basic_iterator result = *this;
+                ++*this;
+                return result;
+            }
+
+            bool operator==(const basic_iterator &other) const noexcept { return idx_ == other.idx_; }
+
+        private:
+            void skip_empty() noexcept
+            {
+                while (idx_ < end_ && !slots_[idx_].full)
+                    ++idx_;
+            }
+
+            Slot *slots_;
+            std::size_t idx_;
+            std::size_t end_;
+        };
+
+    public:
+        using iterator = basic_iterator<slot_t>;
+        using const_iterator = basic_iterator<const slot_t>;
+
+        position_map_t() : size_(0) {}
+        explicit position_map_t(std::pmr::memory_resource *resource)
+            : slots_(resource), size_(0) {}
+
+        std::size_t size() const noexcept { return size_; }
+        bool empty() const noexcept { return size_ == 0; }
+
+        // Removes all entries, capacity stays the same.
+        void clear() noexcept
+        {
+            if (size_)
+            {
+                for (slot_t &slot : slots_)
+                    slot.full = false;
+                size_ = 0;
+            }
+        }
+
+        void reserve(const std::size_t count)
+        {
+            if (count * 4 > slots_.size() * 3)
+                rehash(std::bit_ceil(std::max<std::size_t>(16, (count * 4 + 2) / 3)));
+        }
+
+        // Returns pointer to value stored for position or nullptr.
+        Value *find(const position_t &position) noexcept
+        {
+            const std::size_t idx = find_index(position.packed());
+            return idx == NOT_FOUND ? nullptr : &slots_[idx].value;
+        }
+
+        const Value *find(const position_t &position) const noexcept
+        {
+            const std::size_t idx = find_index(position.packed());
+            return idx == NOT_FOUND ? nullptr : &slots_[idx].value;
+        }
+
+        bool contains(const position_t &position) const noexcept
+        {
+            return find_index(position.packed()) != NOT_FOUND;
+        }
+
+        // Inserts value if position is not in map yet. Returns value stored for position and true if it was inserted.
+        std::pair<Value *, bool> insert(const position_t &position, const Value &value)
+        {
+            reserve(size_ + 1);
+            const uint32_t key = position.packed();
+            std::size_t idx = home(key);
+            while (slots_[idx].full)
+            {
+                if (slots_[idx].key == key)
+                    return {&slots_[idx].value, false};
+                idx = (idx + 1) & mask();
+            }
+            slots_[idx] = slot_t{.key = key, .full = true, .value = value};
+            ++size_;
+            return {&slots_[idx].value, true};
+        }
+
+        Value &operator[](const position_t &position)
+        {
+            return *insert(position, Value{}).first;
+        }
+
+        // Returns true if position was removed.
+        bool erase(const position_t &position) noexcept
+        {
+            std::size_t hole = find_index(position.packed());
+            if (hole == NOT_FOUND)
+                return false;
+            // Following entries of the same probe sequence are moved into the hole, so no probe
+            // sequence is broken by an empty slot.
+            for (std::size_t idx = (hole + 1) & mask(); slots_[idx].full; idx = (idx + 1) & mask())
+            {
+                const std::size_t entry_home = home(slots_[idx].key);
+                const bool can_move = hole <= idx ? (entry_home <= hole || entry_home > idx)
+                                                  : (entry_home <= hole && entry_home > idx);
+                if (can_move)
+                {
+                    slots_[hole] = slots_[idx];
+                    hole = idx;
+                }
+            }
+            slots_[hole].full = false;
+            --size_;
+            return true;
+        }
+
+        iterator begin() { return iterator(slots_.data(), 0, slots_.size()); }
+        iterator end() { return iterator(slots_.data(), slots_.size(), slots_.size()); }
+        const_iterator begin() const { return const_iterator(slots_.data(), 0, slots_.size()); }
+        const_iterator end() const { return const_iterator(slots_.data(), slots_.size(), slots_.size()); }
+
+    private:
+        static constexpr std::size_t NOT_FOUND = static_cast<std::size_t>(-1);
+
+        std::size_t mask() const noexcept { return slots_.size() - 1; }
+
+        std::size_t home(const uint32_t key) const noexcept { return position_t::mix(key) & mask(); }
+
+        std::size_t find_index(const uint32_t key) const noexcept
+        {
+            if (slots_.empty())
+                return NOT_FOUND;
+            for (std::size_t idx = home(key); slots_[idx].full; idx = (idx + 1) & mask())
+            {
+                if (slots_[idx].key == key)
+                    return idx;
+            }
+            return NOT_FOUND;
+        }
+
+        void rehash(const std::size_t capacity)
+        {
+            std::pmr::vector<slot_t> old_slots(capacity, slots_.get_allocator());
+            old_slots.swap(slots_);
+            for (const slot_t &slot : old_slots)
+            {
+                if (!slot.full)
+                    continue;
+                std::size_t idx = home(slot.key);
+                while (slots_[idx].full)
+                    idx = (idx + 1) & mask();
+                slots_[idx] = slot;
+            }
+        }
+
+        std::pmr::vector<slot_t> slots_;
+        std::size_t size_;
+    };
+
+    // Set of positions on top of position_map_t. Iteration order is unspecified.
+    class position_set_t
+    {
+        struct no_value_t
+        {
+        };
+        using map_t = position_map_t<no_value_t>;
+
+    public:
+        using value_type = position_t;
+
+        class iterator
+        {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = position_t;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const position_t *;
+            using reference = const position_t &;
+
+            iterator() : position_{} {}
+            iterator(map_t::const_iterator it, map_t::const_iterator end) : it_(it), end_(end) { load(); }
+
+            reference operator*() const noexcept { return position_; }
+            pointer operator->() const noexcept { return &position_; }
+
+            iterator &operator++() noexcept
+            {
+                ++it_;
+                load();
+                return *this;
+            }
+
+            iterator operator++(int) noexcept
+            {
+                iterator result = *this;
+                ++*this;
+                return result;
+            }
+
+            bool operator==(const iterator &other) const noexcept { return it_ == other.it_; }
+
+        private:
+            void load() noexcept
+            {
+                if (!(it_ == end_))
+                    position_ = it_.position();
+            }
+
+            map_t::const_iterator it_;
+            map_t::const_iterator end_;
+            position_t position_;
+        };
+
+        position_set_t() {}
+        explicit position_set_t(std::pmr::memory_resource *resource) : map_(resource) {}
+
+        std::size_t size() const noexcept { return map_.size(); }
+        bool empty() const noexcept { return map_.empty(); }
+        void clear() noexcept { map_.clear(); }
+        void reserve(const std::size_t count) { map_.reserve(count); }
+
+        bool contains(const position_t &position) const noexcept { return map_.contains(position); }
+
+        // Returns true if position was inserted, false if it was already there.
+        bool insert(const position_t &position) { return map_.insert(position, no_value_t{}).second; }
+
+        // Returns true if position was removed.
+        bool erase(const position_t &position) noexcept { return map_.erase(position); }
+
+        iterator begin() const { return iterator(map_.begin(), map_.end()); }
+        iterator end() const { return iterator(map_.end(), map_.end()); }
+
+        bool operator==(const position_set_t &other) const noexcept
+        {
+            return size() == other.size() &&
+                   std::all_of(begin(), end(), [&other](const position_t &position)
+                               { return other.contains(position); });
+        }
+
+    private:
+        map_t map_;
+    };
+
+    using explosions_t = position_set_t;
+    using blocks_destroyed_t = position_set_t;
+
+} // namespace bomberman
+
+#endif // BOMBERMAN_POSITION_SET_H
@@ -0,0 +1,414 @@
+#ifndef BOMBERMAN_RECORDER_H
+#define BOMBERMAN_RECORDER_H
+
+#include "engine.h"
+#include "errors.h"
+
+#include <boost/log/trivial.hpp>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <optional>
+#include <string>
+#include <variant>
+
+namespace bomberman
+{
+
+    // Record file starts with magic and version, followed by records. Every record starts with its code:
+    //   Session     - server arguments, written when a room starts. Engine of the room is created anew.
+    //   GameStarted - players of the game, in the format of GameStarted message.
+    //   Turn        - inputs applied in the next turn: count, then player id, client message code and
+    //                 direction for Move. Join messages are ignored in game and are not recorded.
+    // Numbers are in network order. File is only appended to, so one file may hold many sessions and a
+    // truncated last record (server killed while writing) is ignored by the reader. Writes are buffered
+    // by the stream and flushed at the end of every game, so a killed server may lose turns of the game
+    // in progress.
+    static constexpr char RECORD_MAGIC[4] = {'B', 'M', 'R', 'C'};
+    static constexpr uint8_t RECORD_VERSION = 1;
+
+    enum class record_code_t : uint8_t
+    {
+        Session = 0,
+        GameStarted = 1,
+        Turn = 2,
+    };
+
+    struct session_record_t
+    {
+        robots_server_args_t args;
+    };
+
+    struct game_started_record_t
+    {
+        players_t players;
+    };
+
+    struct turn_record_t
+    {
+        player_inputs_t inputs;
+    };
+
+    using record_t = std::variant<session_record_t, game_started_record_t, turn_record_t>;
+
+    // Appends game of one room to record file. Used on the game strand of the room only, which does not
+    // wait for the disk until a game ends.
+    class GameRecorder
+    {
+    public:
+        GameRecorder(const std::string &path, const robots_server_args_t &args)
+        {
+            std::error_code ec;
+            const bool new_file = !std::filesystem::exists(path, ec) || std::filesystem::file_size(path, ec) == 0;
+            file_.open(path, std::ios::binary | std::ios::app);
+            if (!file_)
+                throw InvalidArguments("can not open record file " + path);
+
+            if (new_file)
+            {
+                buffer_.insert(buffer_.end(), std::begin(RECORD_MAGIC), std::end(RECORD_MAGIC));
+                write_number<uint8_t>(RECORD_VERSION);
+            }
+            write_number(record_code_t::Session);
+            write_number<bomb_timer_t>(args.bomb_timer);
+            write_number<players_count_t>(args.players_count);
+            write_number<uint32_t>(static_cast<uint32_t>(args.turn_duration >> 32));
+            write_number<uint32_t>(static_cast<uint32_t>(args.turn_duration));
+            write_number<explosion_radius_t>(args.explosion_radius);
+            write_number<uint16_t>(args.initial_blocks);
+            write_number<game_length_t>(args.game_length);
+            write_string(args.server_name);
+            write_number<uint16_t>(args.port);
+            write_number<uint32_t>(args.seed);
+            write_number<size_x_t>(args.size_x);
+            write_number<size_y_t>(args.size_y);
+            write_record();
+        }
+
+        ~GameRecorder()
+        {
+            flush();
+        }
+
+        // Passes records buffered by the stream to the file.
+        void flush()
+        {
+            file_.flush();
+            if (!file_)
+                BOOST_LOG_TRIVIAL(debug) << "Error writing record file";
+        }
+
+        void record_game_started(const players_t &players)
+        {
+            write_number(record_code_t::GameStarted);
+            write_number<map_len_t>(static_cast<map_len_t>(players.size()));
+            for (const auto &[player_id, player] : players)
+            {
+                write_number<player_id_t>(player_id);
+                write_string(player.name);
+                write_string(player.address);
+            }
+            write_record();
+        }
+
+        // Records messages of players taking part in the game, others are ignored by the engine anyway.
+        void record_turn(const player_inputs_t &inputs, const players_t &players)
+        {
+            write_number(record_code_t::Turn);
+            const std::size_t count_idx = buffer_.size();
+            uint8_t count = 0;
+            write_number<uint8_t>(count);
+            for (const auto &[player_id, client_message] : inputs)
+            {
+                if (!players.contains(player_id) || std::holds_alternative<Join>(client_message))
+                    continue;
+                write_number<player_id_t>(player_id);
+                if (std::holds_alternative<PlaceBomb>(client_message))
+                    write_number(client_message_code_t::PlaceBomb);
+                else if (std::holds_alternative<PlaceBlock>(client_message))
+                    write_number(client_message_code_t::PlaceBlock);
+                else
+                {
+                    write_number(client_message_code_t::Move);
+                    write_number(std::get<Move>(client_message).direction);
+                }
+                count++;
+            }
+            buffer_[count_idx] = static_cast<char>(count);
+            write_record();
+        }
+
+    private:
+        template <typename T>
+        void write_number(T number)
+        {
+            if constexpr (sizeof(T) == 2)
+                number = std::bit_cast<T>(htons(std::bit_cast<uint16_t>(number)));
+            else if constexpr (sizeof(T) == 4)
+                number = std::bit_cast<T>(htonl(std::bit_cast<uint32_t>(number)));
+            const char *bytes = reinterpret_cast<const char *>(&number);
+            buffer_.insert(buffer_.end(), bytes, bytes + sizeof(T));
+        }
+
+        void write_string(const std::string &s)
+        {
+            write_number<str_len_t>(static_cast<str_len_t>(s.size()));
+            buffer_.insert(buffer_.end(), s.begin(), s.end());
+        }
+
+        // Every record is passed to the stream at once, so a crash can only cut the last one written.
+        void write_record()
+        {
+            file_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+            buffer_.clear();
+            if (!file_)
+                BOOST_LOG_TRIVIAL(debug) << "Error writing record file";
+        }
+
+        std::ofstream file_;
+        buffer_t buffer_;
+    };
+
+    // Read-only memory mapping of a whole file.
+    class mapped_file_t
+    {
+    public:
+        explicit mapped_file_t(const std::string &path)
+            : data_(nullptr), size_(0)
+        {
+            const int fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+                throw InvalidArguments("can not open record file " + path);
+            struct stat file_stat;
+            if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0)
+            {
+                size_ = static_cast<std::size_t>(file_stat.st_size);
+                void *data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (data == MAP_FAILED)
+                {
+                    close(fd);
+                    throw InvalidArguments("can not map record file " + path);
+                }
+                madvise(data, size_, MADV_SEQUENTIAL);
+                data_ = static_cast<const char *>(data);
+            }
+            close(fd);
+        }
+
+        mapped_file_t(const mapped_file_t &) = delete;
+        mapped_file_t &operator=(const mapped_file_t &) = delete;
+
+        ~mapped_file_t()
+        {
+            if (data_)
+                munmap(const_cast<char *>(data_), size_);
+        }
+
+        const char *data() const noexcept { return data_; }
+        std::size_t size() const noexcept { return size_; }
+
+    private:
+        const char *data_;
+        std::size_t size_;
+    };
+
+    // Decodes records from memory. next() returns nothing at the end of data or at a truncated record.
+    class RecordReader
+    {
+    public:
+        RecordReader(const char *data, const std::size_t size)
+            : data_(data), size_(size), read_idx_(0)
+        {
+            if (size_ < sizeof(RECORD_MAGIC) + 1 || std::memcmp(data_, RECORD_MAGIC, sizeof(RECORD_MAGIC)) != 0)
+                throw InvalidMessage("record file");
+            read_idx_ = sizeof(RECORD_MAGIC);
+            if (decode_number<uint8_t>() != RECORD_VERSION)
+                throw InvalidMessage("record file of unsupported version");
+        }
+
+        std::optional<record_t> next()
+        {
+            const std::size_t record_idx = read_idx_;
+            try
+            {
+                return read_record();
+            }
+            catch (truncated_t &)
+            {
+                if (record_idx != size_)
+                    BOOST_LOG_TRIVIAL(debug) << "Truncated record at byte " << record_idx << ", ignoring rest of the file";
+                read_idx_ = size_;
+                return {};
+            }
+        }
+
+    private:
+        struct truncated_t
+        {
+        };
+
+        record_t read_record()
+        {
+            switch (decode_number<record_code_t>())
+            {
+            case record_code_t::Session:
+            {
+                session_record_t session;
+                session.args.bomb_timer = decode_number<bomb_timer_t>();
+                session.args.players_count = decode_number<players_count_t>();
+                const uint64_t turn_duration_high = decode_number<uint32_t>();
+                session.args.turn_duration = (turn_duration_high << 32) | decode_number<uint32_t>();
+                session.args.explosion_radius = decode_number<explosion_radius_t>();
+                session.args.initial_blocks = decode_number<uint16_t>();
+                session.args.game_length = decode_number<game_length_t>();
+                session.args.server_name = decode_string();
+                session.args.port = decode_number<uint16_t>();
+                session.args.seed = decode_number<uint32_t>();
+                session.args.size_x = decode_number<size_x_t>();
+                session.args.size_y = decode_number<size_y_t>();
+                return session;
+            }
+            case record_code_t::GameStarted:
+            {
+                game_started_record_t game_started;
+                map_len_t players_count = decode_number<map_len_t>();
+                while (players_count--)
+                {
+                    const player_id_t player_id = decode_number<player_id_t>();
+                    player_t player;
+                    player.name = decode_string();
+                    player.address = decode_string();
+                    game_started.players.insert({player_id, player});
+                }
+                return game_started;
+            }
+            case record_code_t::Turn:
+            {
+                turn_record_t turn;
+                uint8_t inputs_count = decode_number<uint8_t>();
+                while (inputs_count--)
+                {
+                    const player_id_t player_id = decode_number<player_id_t>();
+                    switch (decode_number<client_message_code_t>())
+                    {
+                    case client_message_code_t::PlaceBomb:
+                        turn.inputs.insert({player_id, PlaceBomb{}});
+                        break;
+                    case client_message_code_t::PlaceBlock:
+                        turn.inputs.insert({player_id, PlaceBlock{}});
+                        break;
+                    case client_message_code_t::Move:
+                        turn.inputs.insert({player_id, Move{decode_number<direction_t>()}});
+                        break;
+                    default:
+                        throw InvalidMessage("record file");
+                    }
+                }
+                return turn;
+            }
+            }
+            throw InvalidMessage("record file");
+        }
+
+        template <typename T>
+        T decode_number()
+        {
+            if (size_ - read_idx_ < sizeof(T))
+                throw truncated_t{};
+            T result;
+            std::memcpy(&result, data_ + read_idx_, sizeof(T));
+            if constexpr (sizeof(T) == 2)
+                result = std::bit_cast<T>(ntohs(std::bit_cast<uint16_t>(result)));
+            else if constexpr (sizeof(T) == 4)
+                result = std::bit_cast<T>(ntohl(std::bit_cast<uint32_t>(result)));
+            read_idx_ += sizeof(T);
+            return result;
+        }
+
+        std::string decode_string()
+        {
+            const str_len_t str_len = decode_number<str_len_t>();
+            if (size_ - read_idx_ < str_len)
+                throw truncated_t{};
+            std::string result(data_ + read_idx_, str_len);
+            read_idx_ += str_len;
+            return result;
+        }
+
+        const char *data_;
+        std::size_t size_;
+        std::size_t read_idx_;
+    };
+
+    // Feeds recorded sessions through GameEngine the same way RobotsServer does and passes every
+    // message the server broadcast during games (GameStarted, Turn, GameEnded) to the callback.
+    class GameReplayer
+    {
+    public:
+        using message_callback_t = std::function<void(server_message_t &)>;
+
+        explicit GameReplayer(message_callback_t callback)
+            : callback_(std::move(callback)), games_(0), turns_(0) {}
+
+        void replay(RecordReader &reader)
+        {
+            while (auto record = reader.next())
+            {
+                std::visit(overloaded{
+                               [this](session_record_t &session)
+                               {
+                                   engine_.emplace(session.args);
+                               },
+                               [this](game_started_record_t &game_started)
+                               {
+                                   if (!engine_)
+                                       throw InvalidMessage("record file, game without session");
+                                   server_message_t message = GameStarted(game_started.players);
+                                   callback_(message);
+                                   events_t events = engine_->start_game(game_started.players);
+                                   message = Turn(0, std::move(events));
+                                   callback_(message);
+                               },
+                               [this](turn_record_t &turn)
+                               {
+                                   if (!engine_ || engine_->state().players.empty())
+                                       throw InvalidMessage("record file, turn outside of game");
+                                   events_t events = engine_->step(turn.inputs);
+                                   server_message_t message = Turn(engine_->state().turn, std::move(events));
+                                   callback_(message);
+                                   turns_++;
+                                   if (engine_->finished())
+                                   {
+                                       scores_t scores = engine_->state().scores;
+                                       message = GameEnded(scores);
+                                       callback_(message);
+                                       engine_->reset();
+                                       games_++;
+                                   }
+                               },
+                           },
+                           record.value());
+            }
+        }
+
+        std::size_t games() const noexcept { return games_; }
+        std::size_t turns() const noexcept { return turns_; }
+
+    private:
+        message_callback_t callback_;
+        std::optional<GameEngine> engine_;
+        std::size_t games_;
+        std::size_t turns_;
+    };
+
+} // namespace bomberman
+
+#endif // BOMBERMAN_RECORDER_H
@@ -0,0 +1,116 @@
+#include "net.h"
+#include "recorder.h"
+
+#include <boost/log/expressions.hpp>
+#include <boost/log/trivial.hpp>
+#include <boost/program_options.hpp>
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+
+#ifdef NDEBUG
+    static const bool ROBOTS_DEBUG = false;
+#else
+    static const bool ROBOTS_DEBUG = true;
+#endif
+
+    void init_logging()
+    {
+        if (ROBOTS_DEBUG)
+        {
+            // Log debug informations.
+            boost::log::core::get()->set_filter(boost::log::trivial::severity >= boost::log::trivial::debug);
+        }
+        else
+        {
+            // No logs.
+            boost::log::core::get()->set_filter(boost::log::trivial::severity > boost::log::trivial::fatal);
+        }
+    }
+
+    struct robots_replayer_args_t
+    {
+        std::string record_path;
+        std::string output_path;
+    };
+
+    robots_replayer_args_t get_replayer_arguments(int ac, char *av[])
+    {
+        boost::program_options::options_description desc("Usage");
+        desc.add_options()("-h", "produce help message")("-i", boost::program_options::value<std::string>(), "record-file <String>")("-o", boost::program_options::value<std::string>(), "output-file <String, parametr opcjonalny>, receives serialized GameStarted, Turn and GameEnded messages");
+
+        boost::program_options::variables_map vm;
+        boost::program_options::store(boost::program_options::parse_command_line(ac, av, desc), vm);
+        boost::program_options::notify(vm);
+
+        if (vm.count("-h") || !vm.count("-i"))
+        {
+            std::cout << desc;
+            exit(1);
+        }
+
+        robots_replayer_args_t args;
+        args.record_path = vm["-i"].as<std::string>();
+        if (vm.count("-o"))
+            args.output_path = vm["-o"].as<std::string>();
+        return args;
+    }
+
+} // namespace
+
+int main(int ac, char *av[])
+{
+    try
+    {
+        init_logging();
+        robots_replayer_args_t args = get_replayer_arguments(ac, av);
+
+        bomberman::mapped_file_t record_file(args.record_path);
+        bomberman::RecordReader reader(record_file.data(), record_file.size());
+
+        // Messages are serialized exactly like the server sends them, so output can be compared with captured traffic.
+        std::ofstream output;
+        if (!args.output_path.empty())
+        {
+            output.open(args.output_path, std::ios::binary | std::ios::trunc);
+            if (!output)
+                throw bomberman::InvalidArguments("can not open output file " + args.output_path);
+        }
+        bomberman::NetSerializer net_serializer;
+        std::size_t output_bytes = 0;
+        bomberman::GameReplayer replayer([&](bomberman::server_message_t &message)
+                                         {
+                                             if (!output.is_open())
+                                                 return;
+                                             const bomberman::buffer_t &buffer = net_serializer.serialize(message);
+                                             output.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                                             output_bytes += buffer.size(); });
+
+        const auto start = std::chrono::steady_clock::now();
+        replayer.replay(reader);
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << "games: " << replayer.games() << ", turns: " << replayer.turns() << ", time: " << seconds << " s\n"
+                  << "turns per second: " << replayer.turns() / seconds << "\n";
+        if (output.is_open())
+            std::cout << "written " << output_bytes << " bytes to " << args.output_path << "\n";
+    }
+    catch (std::exception &e)
+    {
+        BOOST_LOG_TRIVIAL(fatal) << "error: " << e.what() << "\n";
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    catch (...)
+    {
+        BOOST_LOG_TRIVIAL(fatal) << "Exception of unknown type!\n";
+        std::cerr << "unknown problem\n";
+        return 1;
+    }
+
+    return 0;
+}
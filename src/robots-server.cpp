@@ -35,11 +35,10 @@ int main(int ac, char *av[])
     try
     {
         init_logging();
-        bomberman::robots_server_args_t args = bomberman::get_server_arguments(ac, av);
-        boost::asio::io_context io_context;
+        bomberman::robots_rooms_args_t args = bomberman::get_server_arguments(ac, av);
 
-        bomberman::RobotsServer robot_server(args, io_context);
-        io_context.run();
+        bomberman::RoomManager room_manager(args.rooms, args.port, args.io_threads);
+        room_manager.run();
     }
     catch (std::exception &e)
     {
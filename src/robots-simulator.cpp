@@ -0,0 +1,142 @@
+#include "simulator.h"
+
+#include <boost/algorithm/string.hpp>
+#include <boost/log/expressions.hpp>
+#include <boost/log/trivial.hpp>
+#include <boost/program_options.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <map>
+
+namespace
+{
+
+#ifdef NDEBUG
+    static const bool ROBOTS_DEBUG = false;
+#else
+    static const bool ROBOTS_DEBUG = true;
+#endif
+
+    void init_logging()
+    {
+        if (ROBOTS_DEBUG)
+        {
+            // Log debug informations.
+            boost::log::core::get()->set_filter(boost::log::trivial::severity >= boost::log::trivial::debug);
+        }
+        else
+        {
+            // No logs.
+            boost::log::core::get()->set_filter(boost::log::trivial::severity > boost::log::trivial::fatal);
+        }
+    }
+
+    struct robots_simulator_args_t
+    {
+        bomberman::robots_server_args_t game_args;
+        std::vector<std::string> bots;
+        uint32_t games;
+        uint32_t threads;
+    };
+
+    robots_simulator_args_t get_simulator_arguments(int ac, char *av[])
+    {
+        boost::program_options::options_description desc("Usage");
+        desc.add_options()("-h", "produce help message")("-b", boost::program_options::value<bomberman::bomb_timer_t>(), "bomb-timer <u16>")("-e", boost::program_options::value<bomberman::explosion_radius_t>(), "explosion-radius <u16>")("-k", boost::program_options::value<uint16_t>(), "initial-blocks <u16>")("-l", boost::program_options::value<bomberman::game_length_t>(), "game-length <u16>")("-x", boost::program_options::value<bomberman::size_x_t>(), "size-x <u16>")("-y", boost::program_options::value<bomberman::size_y_t>(), "size-y <u16>")("-s", boost::program_options::value<uint32_t>()->default_value(static_cast<uint32_t>(time(NULL))), "seed of the first game <u32, parametr opcjonalny>, game i uses seed + i")("-g", boost::program_options::value<uint32_t>(), "games <u32>")("-j", boost::program_options::value<uint32_t>()->default_value(std::thread::hardware_concurrency()), "threads <u32, parametr opcjonalny>")("-P", boost::program_options::value<std::string>(), "players <comma separated list of random, evade, idle or script:<UDLRBK.>>");
+
+        boost::program_options::variables_map vm;
+        boost::program_options::store(boost::program_options::parse_command_line(ac, av, desc), vm);
+        boost::program_options::notify(vm);
+
+        if (vm.count("-h") || !(vm.count("-b") && vm.count("-e") && vm.count("-k") && vm.count("-l") && vm.count("-x") && vm.count("-y") && vm.count("-g") && vm.count("-P")))
+        {
+            std::cout << desc;
+            exit(1);
+        }
+
+        robots_simulator_args_t args;
+        boost::split(args.bots, vm["-P"].as<std::string>(), boost::is_any_of(","));
+        if (args.bots.empty() || args.bots.size() > std::numeric_limits<bomberman::players_count_t>::max())
+            throw bomberman::InvalidArguments("players count must be unsigned 8-bits integer!");
+
+        args.game_args.bomb_timer = vm["-b"].as<bomberman::bomb_timer_t>();
+        args.game_args.players_count = static_cast<bomberman::players_count_t>(args.bots.size());
+        args.game_args.turn_duration = 0;
+        args.game_args.explosion_radius = vm["-e"].as<bomberman::explosion_radius_t>();
+        args.game_args.initial_blocks = vm["-k"].as<uint16_t>();
+        args.game_args.game_length = vm["-l"].as<bomberman::game_length_t>();
+        args.game_args.server_name = "simulator";
+        args.game_args.port = 0;
+        args.game_args.seed = vm["-s"].as<uint32_t>();
+        args.game_args.size_x = vm["-x"].as<bomberman::size_x_t>();
+        args.game_args.size_y = vm["-y"].as<bomberman::size_y_t>();
+        args.games = vm["-g"].as<uint32_t>();
+        args.threads = std::max<uint32_t>(1, vm["-j"].as<uint32_t>());
+
+        return args;
+    }
+
+} // namespace
+
+int main(int ac, char *av[])
+{
+    try
+    {
+        init_logging();
+        robots_simulator_args_t args = get_simulator_arguments(ac, av);
+
+        // Every game gets its own seed and its own bots, seeded from the game seed.
+        std::vector<bomberman::simulated_game_t> games(args.games);
+        for (uint32_t i = 0; i < args.games; i++)
+        {
+            games[i].args = args.game_args;
+            games[i].args.seed = args.game_args.seed + i;
+            for (std::size_t bot_idx = 0; bot_idx < args.bots.size(); bot_idx++)
+                games[i].bots.push_back(bomberman::make_bot(args.bots[bot_idx], games[i].args.seed * 31 + static_cast<uint32_t>(bot_idx)));
+        }
+
+        std::vector<bomberman::simulation_result_t> results(args.games);
+        const auto start = std::chrono::steady_clock::now();
+        {
+            bomberman::WorkStealingPool pool(args.threads);
+            for (uint32_t i = 0; i < args.games; i++)
+                pool.submit([&games, &results, i]()
+                            { results[i] = bomberman::simulate_game(games[i]); });
+            pool.wait();
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        // Aggregate GameEnded scores by player.
+        std::size_t turns = 0;
+        std::map<bomberman::player_id_t, uint64_t> total_scores;
+        for (const auto &result : results)
+        {
+            turns += result.turns;
+            for (const auto &[player_id, score] : result.scores)
+                total_scores[player_id] += score;
+        }
+
+        std::cout << "games: " << args.games << ", threads: " << args.threads << ", time: " << seconds << " s\n"
+                  << "games per second: " << args.games / seconds << ", turns per second: " << turns / seconds << "\n";
+        for (const auto &[player_id, score] : total_scores)
+        {
+            std::cout << "player " << static_cast<uint16_t>(player_id) << " (" << args.bots[player_id] << "): total score " << score
+                      << ", mean score " << static_cast<double>(score) / std::max<uint32_t>(1, args.games) << "\n";
+        }
+    }
+    catch (std::exception &e)
+    {
+        BOOST_LOG_TRIVIAL(fatal) << "error: " << e.what() << "\n";
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    catch (...)
+    {
+        BOOST_LOG_TRIVIAL(fatal) << "Exception of unknown type!\n";
+        std::cerr << "unknown problem\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,466 @@
+#ifndef BOMBERMAN_SCHEMA_H
+#define BOMBERMAN_SCHEMA_H
+
+#include "board.h"
+#include "messages.h"
+#include "types.h"
+
+#include <arpa/inet.h>
+
+#include <algorithm>
+#include <bit>
+#include <concepts>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace bomberman
+{
+
+    // Wire layout of every message is described once, as the list of its fields in the order they are
+    // sent. Encoder, decoder and size calculation below are generated from these lists:
+    //  - numbers and enums are sent in network order,
+    //  - strings as str_len_t length and bytes,
+    //  - maps as map_len_t length and key, value pairs, other containers as list_len_t length and elements,
+    //  - variants as message code equal to the index of the alternative, followed by its fields,
+    //  - events of a turn as list_len_t count and every event as its code followed by its fields.
+    template <class T>
+    struct schema;
+
+    template <>
+    struct schema<position_t>
+    {
+        static constexpr std::tuple fields{&position_t::x, &position_t::y};
+    };
+
+    template <>
+    struct schema<player_t>
+    {
+        static constexpr std::tuple fields{&player_t::name, &player_t::address};
+    };
+
+    template <>
+    struct schema<bomb_t>
+    {
+        static constexpr std::tuple fields{&bomb_t::position, &bomb_t::timer};
+    };
+
+    // --- EVENTS ---
+    template <>
+    struct schema<BombPlaced>
+    {
+        static constexpr std::tuple fields{&BombPlaced::bomb_id, &BombPlaced::position};
+    };
+
+    template <>
+    struct schema<BombExploded>
+    {
+        static constexpr std::tuple fields{&BombExploded::bomb_id, &BombExploded::robots_destroyed, &BombExploded::blocks_destroyed};
+    };
+
+    template <>
+    struct schema<PlayerMoved>
+    {
+        static constexpr std::tuple fields{&PlayerMoved::player_id, &PlayerMoved::position};
+    };
+
+    template <>
+    struct schema<BlockPlaced>
+    {
+        static constexpr std::tuple fields{&BlockPlaced::position};
+    };
+
+    // --- CLIENT AND INPUT MESSAGES ---
+    template <>
+    struct schema<Join>
+    {
+        static constexpr std::tuple fields{&Join::name};
+    };
+
+    template <>
+    struct schema<PlaceBomb>
+    {
+        static constexpr std::tuple<> fields{};
+    };
+
+    template <>
+    struct schema<PlaceBlock>
+    {
+        static constexpr std::tuple<> fields{};
+    };
+
+    template <>
+    struct schema<Move>
+    {
+        static constexpr std::tuple fields{&Move::direction};
+    };
+
+    // --- SERVER MESSAGES ---
+    template <>
+    struct schema<Hello>
+    {
+        static constexpr std::tuple fields{&Hello::server_name, &Hello::players_count, &Hello::size_x, &Hello::size_y,
+                                           &Hello::game_length, &Hello::explosion_radius, &Hello::bomb_timer};
+    };
+
+    template <>
+    struct schema<AcceptedPlayer>
+    {
+        static constexpr std::tuple fields{&AcceptedPlayer::player_id, &AcceptedPlayer::player};
+    };
+
+    template <>
+    struct schema<GameStarted>
+    {
+        static constexpr std::tuple fields{&GameStarted::players};
+    };
+
+    template <>
+    struct schema<Turn>
+    {
+        static constexpr std::tuple fields{&Turn::turn, &Turn::events};
+    };
+
+    template <>
+    struct schema<GameEnded>
+    {
+        static constexpr std::tuple fields{&GameEnded::scores};
+    };
+
+    // --- DRAW MESSAGES ---
+    template <>
+    struct schema<Lobby>
+    {
+        static constexpr std::tuple fields{&Lobby::server_name, &Lobby::players_count, &Lobby::size_x, &Lobby::size_y,
+                                           &Lobby::game_length, &Lobby::explosion_radius, &Lobby::bomb_timer, &Lobby::players};
+    };
+
+    template <>
+    struct schema<Game>
+    {
+        static constexpr std::tuple fields{&Game::server_name, &Game::size_x, &Game::size_y, &Game::game_length, &Game::turn,
+                                           &Game::players, &Game::players_positions, &Game::blocks, &Game::bombs,
+                                           &Game::explosions, &Game::scores};
+    };
+
+    namespace wire
+    {
+        template <class T>
+        concept has_schema = requires { schema<T>::fields; };
+
+        template <class T>
+        concept number = std::is_arithmetic_v<T> || std::is_enum_v<T>;
+
+        template <class T>
+        struct is_variant : std::false_type
+        {
+        };
+        template <class... Ts>
+        struct is_variant<std::variant<Ts...>> : std::true_type
+        {
+        };
+
+        template <class T>
+        concept map = requires { typename T::key_type; typename T::mapped_type; };
+
+        template <class T>
+        concept sequence = !map<T> && !std::same_as<T, std::string> && requires(const T &value) { value.begin(); value.end(); value.size(); };
+
+        // Values of enums received from the network must be checked before use.
+        template <number T>
+        constexpr bool valid(const T &) { return true; }
+        constexpr bool valid(const direction_t &direction) { return direction <= direction_t::Left; }
+
+        template <class T>
+        constexpr bool fixed_size_v = false;
+
+        template <number T>
+        constexpr bool fixed_size_v<T> = true;
+
+        template <has_schema T>
+        constexpr bool fixed_size_v<T> = std::apply([](auto... fields)
+                                                    { return (fixed_size_v<std::remove_cvref_t<decltype(std::declval<T>().*fields)>> && ...); },
+                                                    schema<T>::fields);
+
+        // Encoded size of types without strings, containers and variants, known at compile time.
+        template <class T>
+        constexpr std::size_t fixed_size()
+        {
+            if constexpr (number<T>)
+                return sizeof(T);
+            else
+                return std::apply([](auto... fields)
+                                  { return (std::size_t{0} + ... + fixed_size<std::remove_cvref_t<decltype(std::declval<T>().*fields)>>()); },
+                                  schema<T>::fields);
+        }
+
+        // --- SIZE ---
+        template <class T>
+        std::size_t encoded_size(const T &value)
+        {
+            if constexpr (fixed_size_v<T>)
+                return fixed_size<T>();
+            else if constexpr (std::same_as<T, std::string>)
+                return sizeof(str_len_t) + value.size();
+            else if constexpr (has_schema<T>)
+                return std::apply([&value](auto... fields)
+                                  { return (std::size_t{0} + ... + encoded_size(value.*fields)); },
+                                  schema<T>::fields);
+            else if constexpr (is_variant<T>::value)
+                return sizeof(message_code_t) + std::visit([](const auto &alternative)
+                                                           { return encoded_size(alternative); },
+                                                           value);
+            else if constexpr (std::same_as<T, events_t>)
+                // Only lists of destroyed robots and blocks differ in size, they are counted all together.
+                return sizeof(list_len_t) + value.size() * sizeof(event_code_t) +
+                       value.bombs_placed().size() * fixed_size<BombPlaced>() +
+                       value.bombs_exploded_count() * (sizeof(bomb_id_t) + 2 * sizeof(list_len_t)) +
+                       value.robots_destroyed_count() * sizeof(player_id_t) +
+                       value.blocks_destroyed_count() * fixed_size<position_t>() +
+                       value.players_moved().size() * fixed_size<PlayerMoved>() +
+                       value.blocks_placed().size() * fixed_size<BlockPlaced>();
+            else if constexpr (map<T>)
+            {
+                using key_t = typename T::key_type;
+                using mapped_t = typename T::mapped_type;
+                if constexpr (fixed_size_v<key_t> && fixed_size_v<mapped_t>)
+                    return sizeof(map_len_t) + value.size() * (fixed_size<key_t>() + fixed_size<mapped_t>());
+                std::size_t result = sizeof(map_len_t);
+                for (const auto &[key, mapped] : value)
+                    result += encoded_size(key) + encoded_size(mapped);
+                return result;
+            }
+            else
+            {
+                static_assert(sequence<T>);
+                using element_t = std::remove_cvref_t<decltype(*value.begin())>;
+                if constexpr (fixed_size_v<element_t>)
+                    return sizeof(list_len_t) + value.size() * fixed_size<element_t>();
+                std::size_t result = sizeof(list_len_t);
+                for (const auto &element : value)
+                    result += encoded_size(element);
+                return result;
+            }
+        }
+
+        // --- ENCODER ---
+        // Writes value at out and moves out past it. Caller provides encoded_size(value) bytes.
+        template <class T>
+        void encode(const T &value, char *&out)
+        {
+            if constexpr (number<T>)
+            {
+                T number = value;
+                if constexpr (sizeof(T) == 2)
+                    number = std::bit_cast<T>(htons(std::bit_cast<uint16_t>(number)));
+                else if constexpr (sizeof(T) == 4)
+                    number = std::bit_cast<T>(htonl(std::bit_cast<uint32_t>(number)));
+                else
+                    static_assert(sizeof(T) == 1);
+                std::memcpy(out, &number, sizeof(T));
+                out += sizeof(T);
+            }
+            else if constexpr (std::same_as<T, std::string>)
+            {
+                encode(static_cast<str_len_t>(value.size()), out);
+                std::memcpy(out, value.data(), value.size());
+                out += value.size();
+            }
+            else if constexpr (has_schema<T>)
+                std::apply([&value, &out](auto... fields)
+                           { (encode(value.*fields, out), ...); },
+                           schema<T>::fields);
+            else if constexpr (is_variant<T>::value)
+            {
+                encode(static_cast<message_code_t>(value.index()), out);
+                std::visit([&out](const auto &alternative)
+                           { encode(alternative, out); },
+                           value);
+            }
+            else if constexpr (std::same_as<T, events_t>)
+            {
+                encode(static_cast<list_len_t>(value.size()), out);
+                value.for_each([&out](const auto &event)
+                               {
+                                   encode(event.code, out);
+                                   encode(event, out); });
+            }
+            else if constexpr (map<T>)
+            {
+                encode(static_cast<map_len_t>(value.size()), out);
+                for (const auto &[key, mapped] : value)
+                {
+                    encode(key, out);
+                    encode(mapped, out);
+                }
+            }
+            else
+            {
+                static_assert(sequence<T>);
+                encode(static_cast<list_len_t>(value.size()), out);
+                for (const auto &element : value)
+                    encode(element, out);
+            }
+        }
+
+        // --- DECODER ---
+        // Source provides:
+        //  - ensure(n): makes n bytes available, waiting for them or failing if they will not come,
+        //  - number<T>(): decodes number in host order,
+        //  - bytes(n): returns pointer to n raw bytes valid until the next call,
+        //  - invalid(): throws, called for unknown message codes and invalid enum values.
+        template <class T, class Source>
+        void decode(T &value, Source &source);
+
+        template <class V, class Source, std::size_t... I>
+        void decode_alternative(V &value, const std::size_t index, Source &source, std::index_sequence<I...>)
+        {
+            const auto decode_as = [&value, &source]<std::size_t J>(std::integral_constant<std::size_t, J>)
+            {
+                std::variant_alternative_t<J, V> alternative;
+                decode(alternative, source);
+                value.template emplace<J>(std::move(alternative));
+            };
+            ((index == I ? (decode_as(std::integral_constant<std::size_t, I>{}), true) : false) || ...);
+        }
+
+        template <class T, class Source>
+        void decode(T &value, Source &source)
+        {
+            if constexpr (number<T>)
+            {
+                value = source.template number<T>();
+                if (!valid(value))
+                    source.invalid();
+            }
+            else if constexpr (std::same_as<T, std::string>)
+            {
+                const str_len_t length = source.template number<str_len_t>();
+                value.assign(source.bytes(length), length);
+            }
+            else if constexpr (has_schema<T>)
+            {
+                // Fixed size structures are read at once and decoded field by field from memory.
+                if constexpr (fixed_size_v<T>)
+                    source.ensure(fixed_size<T>());
+                std::apply([&value, &source](auto... fields)
+                           { (decode(value.*fields, source), ...); },
+                           schema<T>::fields);
+            }
+            else if constexpr (is_variant<T>::value)
+            {
+                const message_code_t code = source.template number<message_code_t>();
+                if (code >= std::variant_size_v<T>)
+                    source.invalid();
+                decode_alternative(value, code, source, std::make_index_sequence<std::variant_size_v<T>>{});
+            }
+            else if constexpr (std::same_as<T, events_t>)
+            {
+                value.clear();
+                list_len_t length = source.template number<list_len_t>();
+                while (length--)
+                {
+                    switch (source.template number<event_code_t>())
+                    {
+                    case event_code_t::BombPlaced:
+                    {
+                        BombPlaced bomb_placed;
+                        decode(bomb_placed, source);
+                        value.push_back(bomb_placed);
+                        break;
+                    }
+                    case event_code_t::BombExploded:
+                    {
+                        value.push_bomb_exploded(source.template number<bomb_id_t>());
+                        list_len_t robots = source.template number<list_len_t>();
+                        while (robots--)
+                            value.add_robot_destroyed(source.template number<player_id_t>());
+                        list_len_t blocks = source.template number<list_len_t>();
+                        while (blocks--)
+                        {
+                            position_t block{};
+                            decode(block, source);
+                            value.add_block_destroyed(block);
+                        }
+                        break;
+                    }
+                    case event_code_t::PlayerMoved:
+                    {
+                        PlayerMoved player_moved;
+                        decode(player_moved, source);
+                        value.push_back(player_moved);
+                        break;
+                    }
+                    case event_code_t::BlockPlaced:
+                    {
+                        BlockPlaced block_placed;
+                        decode(block_placed, source);
+                        value.push_back(block_placed);
+                        break;
+                    }
+                    default:
+                        source.invalid();
+                    }
+                }
+            }
+            else if constexpr (map<T>)
+            {
+                value.clear();
+                map_len_t length = source.template number<map_len_t>();
+                while (length--)
+                {
+                    typename T::key_type key{};
+                    decode(key, source);
+                    typename T::mapped_type mapped{};
+                    decode(mapped, source);
+                    value.insert({key, std::move(mapped)});
+                }
+            }
+            else if constexpr (std::same_as<T, board_t>)
+            {
+                // Board does not know its dimensions, it is made just big enough for received blocks.
+                std::vector<position_t> blocks;
+                list_len_t length = source.template number<list_len_t>();
+                // Counted in 32 bits, so block at coordinate 65535 does not wrap the size to 0. Board can not
+                // be bigger than 65535 cells in a row, so the size is clamped to it.
+                uint32_t size_x = 0;
+                uint32_t size_y = 0;
+                while (length--)
+                {
+                    position_t block{};
+                    decode(block, source);
+                    size_x = std::max<uint32_t>(size_x, block.x + 1);
+                    size_y = std::max<uint32_t>(size_y, block.y + 1);
+                    blocks.push_back(block);
+                }
+                value.resize(static_cast<size_x_t>(std::min<uint32_t>(size_x, std::numeric_limits<size_x_t>::max())),
+                             static_cast<size_y_t>(std::min<uint32_t>(size_y, std::numeric_limits<size_y_t>::max())));
+                for (const position_t &block : blocks)
+                    value.insert(block);
+            }
+            else
+            {
+                static_assert(sequence<T>);
+                value.clear();
+                list_len_t length = source.template number<list_len_t>();
+                while (length--)
+                {
+                    typename T::value_type element{};
+                    decode(element, source);
+                    if constexpr (requires { value.push_back(std::move(element)); })
+                        value.push_back(std::move(element));
+                    else
+                        value.insert(std::move(element));
+                }
+            }
+        }
+    } // namespace wire
+
+} // namespace bomberman
+
+#endif // BOMBERMAN_SCHEMA_H
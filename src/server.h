@@ -1,6 +1,12 @@
 #ifndef BOMBERMAN_SERVER_H
 #define BOMBERMAN_SERVER_H
 
+// Players joining a game in progress get GameStarted and every Turn played so far, encoded once and shared
+// by all of them. With snapshot catch-up (-S) they get a snapshot of game state encoded as turns instead,
+// see snapshot_turns. Turn numbers of a snapshot go backwards: turns numbered 0 restore scores, then turns
+// numbered as turns in which live bombs were placed and then the current turn. Only clients from this tree
+// apply such turns correctly; other clients count bomb timers down by one per Turn received.
+
 // This is just to silent boost pragma message about old version of this file.
 // The correct version is included above.
 #include <boost/core/scoped_enum.hpp>
@@ -8,7 +14,10 @@
 // ---
 
 #include "common.h"
+#include "engine.h"
+#include "interest.h"
 #include "net.h"
+#include "recorder.h"
 
 #include <boost/asio.hpp>
 #include <boost/bind/bind.hpp>
@@ -16,34 +25,29 @@
 #include <boost/log/trivial.hpp>
 #include <boost/program_options.hpp>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <fstream>
 #include <iostream>
+#include <limits>
 #include <list>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <queue>
-#include <random>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <variant>
+#include <vector>
 
 namespace bomberman
 {
 
-    struct robots_server_args_t
-    {
-        bomb_timer_t bomb_timer;
-        players_count_t players_count;
-        turn_duration_t turn_duration;
-        explosion_radius_t explosion_radius;
-        uint16_t initial_blocks;
-        game_length_t game_length;
-        std::string server_name;
-        uint16_t port;
-        uint32_t seed;
-        size_x_t size_x;
-        size_y_t size_y;
-    };
-
     namespace
     {
         Hello hello_from_server_args(const robots_server_args_t &args)
@@ -59,58 +63,190 @@ namespace bomberman
         }
 
         static constinit std::size_t MAX_SERVER_CONNECTIONS = 25;
+
+        // With snapshot catch-up, snapshot of the game for players joining late is encoded when the first of
+        // them comes and is used by next ones until SNAPSHOT_INTERVAL turns pass, then turns played after it
+        // are not kept anymore.
+        static constinit turn_t SNAPSHOT_INTERVAL = 32;
+
+        // BombExploded events of snapshot use id that is never given to a bomb. Clients ignore unknown bombs.
+        static constexpr bomb_id_t SNAPSHOT_BOMB_ID = std::numeric_limits<bomb_id_t>::max();
+
+        // Describes game state with turns that any client can apply to an empty state:
+        //  - turns numbered 0 with BombExploded destroying robots, one turn for every point of the best score,
+        //    as clients give one point per turn, so its size is the sum of scores,
+        //  - turns with BombPlaced of live bombs, numbered as turns in which bombs were placed, so timers match,
+        //  - turn with number of the current turn, with PlayerMoved for every player and BlockPlaced for every block.
+        std::vector<Turn> snapshot_turns(const game_state_t &state)
+        {
+            std::vector<Turn> turns;
+
+            score_t max_score = 0;
+            for (const auto &[_, score] : state.scores)
+                max_score = std::max(max_score, score);
+            for (score_t point = 0; point < max_score; point++)
+            {
+                events_t events;
+                events.push_bomb_exploded(SNAPSHOT_BOMB_ID);
+                for (const auto &[player_id, score] : state.scores)
+                {
+                    if (score > point)
+                        events.add_robot_destroyed(player_id);
+                }
+                turns.emplace_back(0, std::move(events));
+            }
+
+            std::map<turn_t, events_t> bombs_by_turn;
+            for (const auto &[bomb_id, bomb] : state.bombs)
+                bombs_by_turn[bomb.placed_turn].push_back(BombPlaced(bomb_id, bomb.position));
+            for (auto &[placed_turn, events] : bombs_by_turn)
+                turns.emplace_back(placed_turn, std::move(events));
+
+            events_t events;
+            for (const auto &[player_id, position] : state.player_to_position)
+                events.push_back(PlayerMoved(player_id, position));
+            for (const position_t &block : state.blocks)
+                events.push_back(BlockPlaced(block));
+            turns.emplace_back(state.turn, std::move(events));
+
+            return turns;
+        }
     } // namespace
 
+    // Encoded message shared by all connections it is sent to. It is never modified after encoding
+    // and is freed when the last write using it completes.
+    using shared_buffer_t = std::shared_ptr<const buffer_t>;
+
+    // Connection of one client. Its socket is used only on the connection's strand: by the coroutine
+    // reading client messages and by writes draining the outbound queue.
+    struct connection_t
+    {
+        connection_t(boost::asio::strand<boost::asio::io_context::executor_type> _strand,
+                     boost::asio::ip::tcp::socket &&_socket,
+                     std::string _address)
+            : strand(_strand), socket(std::move(_socket)), address(_address), player_id(0) {}
+        boost::asio::strand<boost::asio::io_context::executor_type> strand;
+        boost::asio::ip::tcp::socket socket;
+        std::string address;
+        player_id_t player_id;
+        // Buffers handed over by game logic, waiting for the current write to complete.
+        std::deque<shared_buffer_t> outbound_q;
+        // Buffers written by the current gathered write.
+        std::vector<shared_buffer_t> in_flight;
+        // Bytes ever queued and written. Catch-up of a game in progress is queued before catch_up_end.
+        std::size_t queued_bytes = 0;
+        std::size_t written_bytes = 0;
+        std::size_t catch_up_end = 0;
+        // Set when connection is being closed, nothing more is queued.
+        bool closing = false;
+        // Set when a turn was dropped, until catch-up with the missed state is queued. Written on the
+        // connection strand, read also by game logic at the end of the game.
+        std::atomic<bool> desynced = false;
+        // Set when game logic was asked for catch-up of desynced connection.
+        bool resync_requested = false;
+
+        // Bytes queued after catch-up and not written yet. Catch-up is sent once and may be big, so it is
+        // not limited by the high-watermark.
+        std::size_t backlog() const noexcept
+        {
+            return queued_bytes - std::max(written_bytes, catch_up_end);
+        }
+    };
+
+    using connection_ptr_t = std::shared_ptr<connection_t>;
+
+    // Game logic runs serialized on game_strand_, while every connection reads and writes on its own
+    // strand. Thus io_context of the room may be run by any number of threads. Client messages are posted
+    // to game_strand_, outbound buffers are posted to connection strands and queued there.
     class RobotsServer
     {
     public:
-        RobotsServer(robots_server_args_t &args, boost::asio::io_context &io_context)
+        RobotsServer(const robots_server_args_t &args, boost::asio::io_context &io_context)
             : args_(args),
               io_context_(io_context),
-              random_(args.seed),
-              acceptor_(io_context, boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v6(),
-                                                                   args.port)),
-              turn_timer_(io_context)
+              game_strand_(boost::asio::make_strand(io_context)),
+              engine_(args),
+              turn_timer_(io_context),
+              snapshot_turn_(0),
+              lobby_slots_(0),
+              free_lobby_slots_(0)
         {
             state_ = LOBBY;
-            connect_loop();
+            // Interest regions keep state for every possible player, it is allocated only if they are used.
+            if (args_.interest_tile)
+            {
+                const std::size_t max_players = std::numeric_limits<player_id_t>::max() + 1;
+                interest_.emplace(args_.interest_tile, args_.size_x, args_.size_y);
+                interest_events_.resize(max_players);
+                robots_destroyed_sent_.resize(max_players);
+                robot_positions_.resize(max_players);
+                told_positions_.resize(max_players);
+            }
+            update_free_lobby_slots();
+            if (!args_.record_path.empty())
+                recorder_.emplace(args_.record_path, args_);
         }
 
-        void connect_loop()
+        // Called by RoomManager from the accepting thread. Returns true if this room still had a place
+        // in its lobby, and takes that place for the connection being routed here. The place is given back
+        // by handle_new_connection, which counts the connection as open instead.
+        bool reserve_lobby_slot()
         {
-            acceptor_.async_accept(
-                [this](boost::system::error_code ec, boost::asio::ip::tcp::socket socket)
-                {
-                    if (!ec)
-                    {
-                        // Turn off Nagle's algorithm
-                        boost::asio::ip::tcp::no_delay option(true);
-                        socket.set_option(option);
-                        handle_new_connection(std::move(socket));
-                        connect_loop();
-                    }
-                    else
-                    {
-                        BOOST_LOG_TRIVIAL(debug) << "Error in connect_loop, " << ec.message();
-                    }
+            int free_slots = free_lobby_slots_.load();
+            while (free_slots > 0)
+            {
+                if (free_lobby_slots_.compare_exchange_weak(free_slots, free_slots - 1))
+                    return true;
+            }
+            return false;
+        }
 
-                    connect_loop();
-                });
+        // May be called from any thread. Moves socket to a new strand of this room and passes it to game logic.
+        // Reserved tells if reserve_lobby_slot took a place for the connection.
+        void accept_connection(boost::asio::ip::tcp::socket &&socket, const bool reserved)
+        {
+            boost::system::error_code ec;
+            const auto endpoint = socket.remote_endpoint(ec);
+            if (ec)
+            {
+                BOOST_LOG_TRIVIAL(debug) << "Error in accept_connection, " << ec.message();
+                if (reserved)
+                    free_lobby_slots_++;
+                return;
+            }
+            const std::string address = "[" + endpoint.address().to_string() + "]:" + std::to_string(endpoint.port());
+
+            auto strand = boost::asio::make_strand(io_context_);
+            auto connection = std::make_shared<connection_t>(
+                strand,
+                boost::asio::ip::tcp::socket(strand, endpoint.protocol(), socket.release()),
+                address);
+            boost::asio::post(game_strand_, [this, connection, reserved]()
+                              { handle_new_connection(connection, reserved); });
         }
 
-        void handle_new_connection(boost::asio::ip::tcp::socket &&socket)
+        void handle_new_connection(const connection_ptr_t &connection, const bool reserved)
         {
+            // Reserved place is not in transit anymore, the connection is counted as open below or closed.
+            if (reserved)
+                free_lobby_slots_++;
             // If server reached connection limit, disconnect new clients.
             if (open_connections_hm_.size() == MAX_SERVER_CONNECTIONS)
             {
-                socket.close();
+                boost::asio::post(connection->strand, [connection]()
+                                  { connection->socket.close(); });
                 BOOST_LOG_TRIVIAL(debug) << "Connection limit reached, closing new connection";
             }
             else
             {
                 // Assign player id to new client and call read message from client loop.
-                const player_id_t new_player_id = static_cast<player_id_t>(open_connections_hm_.size());
-                open_connections_hm_.insert({new_player_id, std::move(socket)});
+                // Ids of open connections and of players in current game can not be reused.
+                player_id_t new_player_id = 0;
+                while (open_connections_hm_.contains(new_player_id) || players_.contains(new_player_id))
+                    new_player_id++;
+                connection->player_id = new_player_id;
+                open_connections_hm_.insert({new_player_id, connection});
+                update_free_lobby_slots();
                 messages_to_send_q_.push(
                     target_one_t{
                         .to_who = new_player_id,
@@ -119,81 +255,208 @@ namespace bomberman
                 // Send accepted player and turns to new player if needed.
                 notify_new(new_player_id);
 
-                // Spawn loop for handling connection from this client.
+                // Spawn loop for handling connection from this client on its strand.
                 auto spawn_callback =
-                    [new_player_id, this](boost::asio::yield_context yield)
+                    [connection, this](boost::asio::yield_context yield)
                 {
-                    read_message_from_client(yield, new_player_id);
+                    read_message_from_client(yield, connection);
                 };
-                boost::asio::spawn(io_context_, spawn_callback);
+                boost::asio::spawn(connection->strand, spawn_callback);
             }
         }
 
-        void read_message_from_client(boost::asio::yield_context yield, const player_id_t player_id)
+        // Runs on connection strand.
+        void read_message_from_client(boost::asio::yield_context yield, const connection_ptr_t connection)
         {
             // Create deserializer with client socket.
-            TcpDeserializer tcp_deserializer(open_connections_hm_.at(player_id));
+            TcpDeserializer tcp_deserializer(connection->socket);
 
             while (true)
             {
                 try
                 {
-                    // Receive message from client.
-                    const client_message_t client_message = tcp_deserializer.get_client_message(yield);
-
-                    // Server needs to process this message if it is in LOBBY state.
-                    // In GAME state it automatically processes messages every turn-duration miliseconds.
-                    clients_messages_hm_.insert({player_id, client_message});
-                    if (state_ == LOBBY)
-                    {
-                        process_lobby();
-                    }
+                    // Receive message from client and hand it to game logic.
+                    client_message_t client_message = tcp_deserializer.get_client_message(yield);
+                    boost::asio::post(game_strand_, [this, player_id = connection->player_id, client_message = std::move(client_message)]()
+                                      { receive_client_message(player_id, client_message); });
                 }
                 catch (std::exception &e)
                 {
-                    open_connections_hm_.erase(player_id);
-                    BOOST_LOG_TRIVIAL(debug) << "error processing player: " << player_id << " connection, boost error: " << e.what() << ". Disconnects.\n";
+                    boost::asio::post(game_strand_, [this, connection]()
+                                      { close_connection(connection); });
+                    BOOST_LOG_TRIVIAL(debug) << "error processing player: " << connection->player_id << " connection, boost error: " << e.what() << ". Disconnects.\n";
                     break;
                 }
             }
         }
 
-        void send_to_one(buffer_t &buffer, target_one_t &targeted_message)
+        void receive_client_message(const player_id_t player_id, const client_message_t &client_message)
         {
-            // Send message to one specific client (endpoint).
-            auto target = open_connections_hm_.find(targeted_message.to_who);
-            if (target == open_connections_hm_.end())
+            // Server needs to process this message if it is in LOBBY state.
+            // In GAME state it automatically processes messages every turn-duration miliseconds.
+            clients_messages_hm_.insert({player_id, client_message});
+            if (state_ == LOBBY)
+            {
+                process_lobby();
+            }
+        }
+
+        void close_connection(const connection_ptr_t &connection)
+        {
+            // Connection could have been closed already and its id given to a new one.
+            auto it = open_connections_hm_.find(connection->player_id);
+            if (it == open_connections_hm_.end() || it->second != connection)
+                return;
+
+            open_connections_hm_.erase(it);
+            update_free_lobby_slots();
+            boost::asio::post(connection->strand, [connection]()
+                              {
+                                  boost::system::error_code ec;
+                                  connection->socket.close(ec); });
+        }
+
+        // Lobby slots are free only in LOBBY state, for connections that may still send Join. Places reserved
+        // for connections in transit are taken from free_lobby_slots_ by the accepting thread, so it is changed
+        // by difference of lobby slots and not overwritten.
+        void update_free_lobby_slots()
+        {
+            const int connections = static_cast<int>(open_connections_hm_.size());
+            const int lobby_slots = state_ == LOBBY ? std::max(0, args_.players_count - connections) : 0;
+            free_lobby_slots_ += lobby_slots - lobby_slots_;
+            lobby_slots_ = lobby_slots;
+        }
+
+        // Hands buffer over to connection strand, where it waits in outbound queue for its turn to be written.
+        // Connection with more than outbound_high_watermark bytes queued is a slow consumer: droppable
+        // buffers are skipped if policy allows it, otherwise connection is closed. Connection which skipped
+        // a turn skips all of them until catch-up brings it back in sync, see request_resync.
+        void send_to_connection(const connection_ptr_t &connection, shared_buffer_t buffer, const bool droppable = false)
+        {
+            boost::asio::post(connection->strand, [this, connection, droppable, buffer = std::move(buffer)]() mutable
+                              {
+                                  if (connection->closing || (droppable && connection->desynced))
+                                      return;
+                                  if (connection->backlog() >= args_.outbound_high_watermark)
+                                  {
+                                      if (droppable)
+                                      {
+                                          BOOST_LOG_TRIVIAL(debug) << "client " << connection->player_id << " is slow, dropping turns";
+                                          connection->desynced = true;
+                                          return;
+                                      }
+                                      BOOST_LOG_TRIVIAL(debug) << "client " << connection->player_id << " is slow, disconnects";
+                                      stop_writing(connection);
+                                      return;
+                                  }
+                                  queue_outbound(connection, std::move(buffer)); });
+        }
+
+        // Sends state of the game in progress, which is not limited by the high-watermark. Catch-up for resync
+        // is queued only if connection is still desynced, otherwise an earlier one already brought it back.
+        void send_catch_up(const connection_ptr_t &connection, std::vector<shared_buffer_t> buffers, const bool resync)
+        {
+            boost::asio::post(connection->strand, [this, connection, resync, buffers = std::move(buffers)]() mutable
+                              {
+                                  if (connection->closing || (resync && !connection->desynced))
+                                      return;
+                                  for (shared_buffer_t &buffer : buffers)
+                                      queue_outbound(connection, std::move(buffer));
+                                  connection->catch_up_end = connection->queued_bytes;
+                                  connection->desynced = false;
+                                  connection->resync_requested = false; });
+        }
+
+        // Runs on connection strand.
+        void queue_outbound(const connection_ptr_t &connection, shared_buffer_t buffer)
+        {
+            connection->queued_bytes += buffer->size();
+            connection->outbound_q.push_back(std::move(buffer));
+            if (connection->in_flight.empty())
+                write_outbound(connection);
+        }
+
+        // Runs on connection strand. Desynced connection asks game logic for catch-up once it has drained
+        // below the high-watermark.
+        void request_resync(const connection_ptr_t &connection)
+        {
+            if (!connection->desynced || connection->resync_requested || connection->backlog() >= args_.outbound_high_watermark)
+                return;
+            connection->resync_requested = true;
+            boost::asio::post(game_strand_, [this, connection]()
+                              { resync(connection); });
+        }
+
+        // Sends GameStarted, snapshot and turns after it to connection which dropped turns. Client starts the
+        // game again from them. Game that already ended was caught up by end_game.
+        void resync(const connection_ptr_t &connection)
+        {
+            auto it = open_connections_hm_.find(connection->player_id);
+            if (state_ != GAME || it == open_connections_hm_.end() || it->second != connection)
                 return;
+            send_catch_up(connection, resync_buffers(), true);
+        }
 
-            auto after_write_callback = [to_who = targeted_message.to_who, this](boost::system::error_code ec, std::size_t)
+        // Runs on connection strand, writes all buffers from outbound queue with one gathered write.
+        void write_outbound(const connection_ptr_t &connection)
+        {
+            // Buffers stay alive in in_flight until the write completes.
+            connection->in_flight.assign(std::make_move_iterator(connection->outbound_q.begin()),
+                                         std::make_move_iterator(connection->outbound_q.end()));
+            connection->outbound_q.clear();
+            std::vector<boost::asio::const_buffer> buffers;
+            buffers.reserve(connection->in_flight.size());
+            for (const shared_buffer_t &buffer : connection->in_flight)
+                buffers.push_back(boost::asio::buffer(*buffer));
+
+            auto after_write_callback = [connection, this](boost::system::error_code ec, std::size_t written)
             {
+                // stop_writing already dropped queued buffers and their count.
+                if (connection->closing)
+                    return;
                 if (ec)
                 {
-                    BOOST_LOG_TRIVIAL(debug) << "error sending to client " << to_who << ", disconnects";
-                    open_connections_hm_.erase(to_who);
+                    BOOST_LOG_TRIVIAL(debug) << "error sending to client " << connection->player_id << ", disconnects";
+                    stop_writing(connection);
+                    return;
                 }
+                connection->written_bytes += written;
+                connection->in_flight.clear();
+                if (!connection->outbound_q.empty())
+                    write_outbound(connection);
+                request_resync(connection);
             };
-            boost::asio::async_write(target->second,
-                                     boost::asio::buffer(buffer, buffer.size()),
-                                     after_write_callback);
+            boost::asio::async_write(connection->socket, buffers, after_write_callback);
+        }
+
+        // Runs on connection strand. Drops queued buffers and lets game logic close the connection.
+        void stop_writing(const connection_ptr_t &connection)
+        {
+            connection->closing = true;
+            connection->outbound_q.clear();
+            boost::asio::post(game_strand_, [this, connection]()
+                              { close_connection(connection); });
+        }
+
+        void send_to_one(const shared_buffer_t &buffer, target_one_t &targeted_message)
+        {
+            // Send message to one specific client (endpoint).
+            auto target = open_connections_hm_.find(targeted_message.to_who);
+            if (target == open_connections_hm_.end())
+                return;
+
+            send_to_connection(target->second, buffer);
         }
 
-        void send_to_all(buffer_t &buffer)
+        void send_to_all(const shared_buffer_t &buffer, const bool droppable_by_spectators = false, const bool only_spectators = false)
         {
             // Send message to all open connections.
-            for (auto &[player_id, socket] : open_connections_hm_)
+            const bool may_drop = droppable_by_spectators && args_.slow_consumer_policy == slow_consumer_policy_t::DropSpectatorTurns;
+            for (auto &[player_id, connection] : open_connections_hm_)
             {
-                auto after_write_callback = [to_who = player_id, this](boost::system::error_code ec, std::size_t)
-                {
-                    if (ec)
-                    {
-                        BOOST_LOG_TRIVIAL(debug) << "error sending to client " << to_who << ", disconnects";
-                        open_connections_hm_.erase(to_who);
-                    }
-                };
-                boost::asio::async_write(socket,
-                                         boost::asio::buffer(buffer, buffer.size()),
-                                         after_write_callback);
+                const bool spectator = !players_.contains(player_id);
+                if (spectator || !only_spectators)
+                    send_to_connection(connection, buffer, may_drop && spectator);
             }
         }
 
@@ -205,7 +468,8 @@ namespace bomberman
             while (!messages_to_send_q_.empty())
             {
                 targeted_message_t targeted_message = messages_to_send_q_.front();
-                buffer_t buffer = net_serializer.serialize(targeted_message);
+                // Encoded once, recipients share the buffer.
+                shared_buffer_t buffer = std::make_shared<const buffer_t>(std::move(net_serializer.serialize(targeted_message)));
                 if (std::holds_alternative<target_one_t>(targeted_message))
                     send_to_one(buffer, std::get<target_one_t>(targeted_message));
                 else
@@ -230,23 +494,314 @@ namespace bomberman
             }
             else
             {
-                GameStarted game_started(game_state_.players);
+                GameStarted game_started(players_);
                 target_one_t notify_new{
                     .to_who = player_id,
                     .message = game_started};
                 messages_to_send_q_.push(notify_new);
             }
 
-            // If game events is not empty, it game is in progress and we have to send all events.
-            for (const Turn &turn : turn_messages_l_)
+            send_messages();
+
+            // If game is in progress, send snapshot of its state and turns played after the snapshot.
+            auto connection = open_connections_hm_.find(player_id);
+            if (state_ == GAME && connection != open_connections_hm_.end())
+                send_catch_up(connection->second, snapshot_buffers(), false);
+        }
+
+        // Snapshot and turns played after it. Without snapshot catch-up the snapshot stays empty from turn 0,
+        // so these are all turns of the game.
+        std::vector<shared_buffer_t> snapshot_buffers()
+        {
+            if (!snapshot_)
+                refresh_snapshot();
+            std::vector<shared_buffer_t> buffers;
+            if (!snapshot_->empty())
+                buffers.push_back(snapshot_);
+            // Turns encoded since the last newcomer are moved to a chunk of their own, so every turn is
+            // copied once and all newcomers share the chunks.
+            if (!turns_since_snapshot_.empty())
+            {
+                turns_since_snapshot_chunks_.push_back(std::make_shared<const buffer_t>(std::move(turns_since_snapshot_)));
+                turns_since_snapshot_.clear();
+            }
+            buffers.insert(buffers.end(), turns_since_snapshot_chunks_.begin(), turns_since_snapshot_chunks_.end());
+            return buffers;
+        }
+
+        // Catch-up for connection which dropped turns of the current game.
+        std::vector<shared_buffer_t> resync_buffers()
+        {
+            NetSerializer net_serializer;
+            server_message_t game_started = GameStarted(players_);
+            std::vector<shared_buffer_t> buffers{std::make_shared<const buffer_t>(std::move(net_serializer.serialize(game_started)))};
+            for (shared_buffer_t &buffer : snapshot_buffers())
+                buffers.push_back(std::move(buffer));
+            return buffers;
+        }
+
+        // Encodes current game state for players joining late, turns encoded so far are not needed anymore.
+        // Called only when a player joins and there is no snapshot, so the game loop pays for it only then.
+        void refresh_snapshot()
+        {
+            NetSerializer net_serializer;
+            buffer_t snapshot;
+            for (Turn &turn : snapshot_turns(engine_.state()))
             {
-                target_one_t notify_new{
-                    .to_who = player_id,
-                    .message = turn};
-                messages_to_send_q_.push(notify_new);
+                server_message_t message = std::move(turn);
+                net_serializer.serialize_append(message, snapshot);
             }
+            snapshot_ = std::make_shared<const buffer_t>(std::move(snapshot));
+            turns_since_snapshot_.clear();
+            turns_since_snapshot_chunks_.clear();
+            snapshot_turn_ = engine_.state().turn;
+        }
 
-            send_messages();
+        // Sends turn to everyone and keeps its encoding for players joining before the next snapshot.
+        // With interest regions players get their own parts of the turn and only spectators get all of it.
+        void broadcast_turn(Turn &turn)
+        {
+            const bool filtered = args_.interest_tile != 0;
+            if (filtered)
+                send_interest_turns(turn);
+            NetSerializer net_serializer;
+            server_message_t message = std::move(turn);
+            shared_buffer_t buffer = std::make_shared<const buffer_t>(std::move(net_serializer.serialize(message)));
+            if (snapshot_)
+                turns_since_snapshot_.insert(turns_since_snapshot_.end(), buffer->begin(), buffer->end());
+            send_to_all(buffer, true, filtered);
+        }
+
+        // Sends every connected player events of the turn in its interest region, so its traffic grows with
+        // activity around its robot. BombExploded goes to players which were told about the bomb or watch
+        // destroyed blocks or robots, with blocks of their regions only. Other players get robots destroyed
+        // in the turn at the start of their turn in one BombExploded of SNAPSHOT_BOMB_ID, as every client
+        // counts scores. Player whose region moved gets region snapshot of the tiles that are new for it.
+        void send_interest_turns(const Turn &turn)
+        {
+            const game_state_t &state = engine_.state();
+            std::vector<std::pair<player_id_t, std::vector<interest_index_t::new_tile_t>>> receivers;
+            players_mask_t connected;
+            // Changes are pruned before regions move, so tiles players come back to still have theirs.
+            interest_->prune(turn.turn);
+            for (const auto &[player_id, _] : players_)
+            {
+                if (!open_connections_hm_.contains(player_id))
+                {
+                    interest_->remove(player_id);
+                    continue;
+                }
+                // Destroyed robot is placed again in the same turn, region moves with it.
+                auto position_it = state.player_to_position.find(player_id);
+                std::vector<interest_index_t::new_tile_t> new_tiles;
+                if (position_it != state.player_to_position.end())
+                    new_tiles = interest_->move(player_id, position_it->second, turn.turn);
+                receivers.emplace_back(player_id, std::move(new_tiles));
+                connected.set(player_id);
+                interest_events_[player_id].clear();
+                robots_destroyed_sent_[player_id] = players_mask_t{};
+            }
+
+            const auto to_interested = [this, &connected](const players_mask_t &interested, const auto &event)
+            {
+                interested.for_each([this, &connected, &event](const player_id_t player_id)
+                                    {
+                                        if (connected.test(player_id))
+                                            interest_events_[player_id].push_back(event); });
+            };
+            players_mask_t robots_destroyed;
+            turn.events.for_each(
+                overloaded{
+                    [this, &to_interested](const BombPlaced &bomb_placed)
+                    {
+                        const players_mask_t &interested = interest_->interested(bomb_placed.position);
+                        bomb_watchers_[bomb_placed.bomb_id] = interested;
+                        to_interested(interested, bomb_placed);
+                    },
+                    [this, &connected, &robots_destroyed, &turn](const BombExploded &bomb_exploded)
+                    {
+                        players_mask_t watchers;
+                        if (auto it = bomb_watchers_.find(bomb_exploded.bomb_id); it != bomb_watchers_.end())
+                        {
+                            watchers = it->second;
+                            bomb_watchers_.erase(it);
+                        }
+                        for (const position_t &block_destroyed : bomb_exploded.blocks_destroyed)
+                        {
+                            interest_->block_changed(block_destroyed, turn.turn);
+                            watchers |= interest_->interested(block_destroyed);
+                        }
+                        // Every client removes destroyed robots, with this explosion or with the summary.
+                        for (const player_id_t robot_destroyed : bomb_exploded.robots_destroyed)
+                        {
+                            robots_destroyed.set(robot_destroyed);
+                            std::optional<position_t> &last_position = robot_positions_[robot_destroyed];
+                            if (last_position.has_value())
+                                watchers |= interest_->interested(*last_position);
+                            last_position.reset();
+                            connected.for_each([this, robot_destroyed](const player_id_t player_id)
+                                               { told_positions_[player_id].erase(robot_destroyed); });
+                        }
+                        watchers.for_each([this, &connected, &bomb_exploded](const player_id_t player_id)
+                                          {
+                                              if (!connected.test(player_id))
+                                                  return;
+                                              events_t &events = interest_events_[player_id];
+                                              events.push_bomb_exploded(bomb_exploded.bomb_id);
+                                              for (const player_id_t robot_destroyed : bomb_exploded.robots_destroyed)
+                                              {
+                                                  events.add_robot_destroyed(robot_destroyed);
+                                                  robots_destroyed_sent_[player_id].set(robot_destroyed);
+                                              }
+                                              for (const position_t &block_destroyed : bomb_exploded.blocks_destroyed)
+                                              {
+                                                  if (interest_->is_interested(player_id, block_destroyed))
+                                                      events.add_block_destroyed(block_destroyed);
+                                              } });
+                    },
+                    [this, &connected](const PlayerMoved &player_moved)
+                    {
+                        // Robot leaving a region is moved out of it for players watching it.
+                        players_mask_t interested = interest_->interested(player_moved.position);
+                        std::optional<position_t> &last_position = robot_positions_[player_moved.player_id];
+                        if (last_position.has_value())
+                            interested |= interest_->interested(*last_position);
+                        last_position = player_moved.position;
+                        interested.for_each([this, &connected, &player_moved](const player_id_t player_id)
+                                            {
+                                                if (!connected.test(player_id))
+                                                    return;
+                                                interest_events_[player_id].push_back(player_moved);
+                                                told_positions_[player_id][player_moved.player_id] = player_moved.position; });
+                    },
+                    [this, &to_interested, &turn](const BlockPlaced &block_placed)
+                    {
+                        interest_->block_changed(block_placed.position, turn.turn);
+                        to_interested(interest_->interested(block_placed.position), block_placed);
+                    },
+                });
+
+            NetSerializer net_serializer;
+            for (auto &[player_id, new_tiles] : receivers)
+            {
+                buffer_t buffer;
+                // Robots destroyed far away come first, before they may be placed again in the region.
+                turn_events_.clear();
+                robots_destroyed.for_each([this, player_id](const player_id_t robot_destroyed)
+                                          {
+                                              if (robots_destroyed_sent_[player_id].test(robot_destroyed))
+                                                  return;
+                                              if (turn_events_.empty())
+                                                  turn_events_.push_bomb_exploded(SNAPSHOT_BOMB_ID);
+                                              turn_events_.add_robot_destroyed(robot_destroyed); });
+                const bool summary = !turn_events_.empty();
+                if (summary)
+                    turn_events_.append(interest_events_[player_id]);
+                events_t &events = summary ? turn_events_ : interest_events_[player_id];
+                // Events are moved into the message and back, so their memory is reused next turn.
+                server_message_t message = Turn(turn.turn, std::move(events));
+                net_serializer.serialize_append(message, buffer);
+                events = std::move(std::get<Turn>(message).events);
+                if (!new_tiles.empty())
+                {
+                    for (Turn &snapshot_turn : region_snapshot_turns(player_id, new_tiles))
+                    {
+                        server_message_t snapshot_message = std::move(snapshot_turn);
+                        net_serializer.serialize_append(snapshot_message, buffer);
+                    }
+                }
+                send_to_connection(open_connections_hm_.at(player_id), std::make_shared<const buffer_t>(std::move(buffer)));
+            }
+        }
+
+        // Describes part of game state in given tiles, for a player whose interest region just covered them.
+        // It is like snapshot_turns, but applied on top of what the player already knows, so its turn numbers
+        // are not above the current turn and the client takes them as catch-up:
+        //  - turns with BombPlaced of live bombs in the tiles, numbered as turns in which bombs were placed,
+        //  - turn with number of the current turn, starting with BombExploded of blocks destroyed in the tiles
+        //    since the player watched them, then PlayerMoved of robots in the tiles and of robots the player
+        //    last saw in them, and BlockPlaced of blocks placed since then, or of all blocks of tiles the
+        //    player never watched.
+        std::vector<Turn> region_snapshot_turns(const player_id_t player_id, const std::vector<interest_index_t::new_tile_t> &new_tiles)
+        {
+            const game_state_t &state = engine_.state();
+            std::vector<Turn> turns;
+            const auto in_tiles = [this, &new_tiles](const position_t &position)
+            {
+                const position_t tile = interest_->tile_of(position);
+                return std::any_of(new_tiles.begin(), new_tiles.end(), [&tile](const interest_index_t::new_tile_t &new_tile)
+                                   { return new_tile.tile == tile; });
+            };
+
+            // Bombs placed in this turn were already sent with it.
+            std::map<turn_t, events_t> bombs_by_turn;
+            for (const auto &[bomb_id, bomb] : state.bombs)
+            {
+                if (bomb.placed_turn != state.turn && in_tiles(bomb.position))
+                {
+                    bombs_by_turn[bomb.placed_turn].push_back(BombPlaced(bomb_id, bomb.position));
+                    bomb_watchers_[bomb_id].set(player_id);
+                }
+            }
+            for (auto &[placed_turn, events] : bombs_by_turn)
+                turns.emplace_back(placed_turn, std::move(events));
+
+            // Cells where blocks changed since the player watched the tiles, or all cells of tiles it never watched.
+            std::vector<position_t> cells;
+            const uint32_t tile_size = interest_->tile_size();
+            for (const interest_index_t::new_tile_t &new_tile : new_tiles)
+            {
+                if (new_tile.left_turn.has_value())
+                {
+                    interest_->for_each_changed_since(new_tile.tile, *new_tile.left_turn, [&cells](const position_t &position)
+                                                     { cells.push_back(position); });
+                    continue;
+                }
+                const uint32_t end_x = std::min<uint32_t>((new_tile.tile.x + 1) * tile_size, state.blocks.size_x());
+                const uint32_t end_y = std::min<uint32_t>((new_tile.tile.y + 1) * tile_size, state.blocks.size_y());
+                for (uint32_t x = new_tile.tile.x * tile_size; x < end_x; x++)
+                {
+                    for (uint32_t y = new_tile.tile.y * tile_size; y < end_y; y++)
+                    {
+                        const position_t cell{.x = static_cast<uint16_t>(x), .y = static_cast<uint16_t>(y)};
+                        if (state.blocks.contains(cell))
+                            cells.push_back(cell);
+                    }
+                }
+            }
+            // Cell changed many times is described once.
+            std::sort(cells.begin(), cells.end(), [](const position_t &a, const position_t &b)
+                      { return std::tie(a.x, a.y) < std::tie(b.x, b.y); });
+            cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+
+            events_t events;
+            for (const position_t &cell : cells)
+            {
+                if (state.blocks.contains(cell))
+                    continue;
+                if (events.empty())
+                    events.push_bomb_exploded(SNAPSHOT_BOMB_ID);
+                events.add_block_destroyed(cell);
+            }
+            player_to_position_t &told_positions = told_positions_[player_id];
+            for (const auto &[robot_id, position] : state.player_to_position)
+            {
+                auto told_it = told_positions.find(robot_id);
+                const bool told_in_tiles = told_it != told_positions.end() && in_tiles(told_it->second);
+                if (!in_tiles(position) && !told_in_tiles)
+                    continue;
+                events.push_back(PlayerMoved(robot_id, position));
+                told_positions[robot_id] = position;
+            }
+            for (const position_t &cell : cells)
+            {
+                if (state.blocks.contains(cell))
+                    events.push_back(BlockPlaced(cell));
+            }
+            if (!events.empty())
+                turns.emplace_back(state.turn, std::move(events));
+
+            return turns;
         }
 
         void process_lobby()
@@ -262,20 +817,19 @@ namespace bomberman
                 processed_messages.insert(player_id);
 
                 // Ignore messages in LOBBY from accepted player.
-                if (game_state_.players.contains(player_id))
+                if (players_.contains(player_id))
                     continue;
 
                 // Client wants to join the game.
                 if (std::holds_alternative<Join>(client_message))
                 {
                     Join join = std::get<Join>(client_message);
-                    // Find their's socket to get address and port.
-                    auto &socket = open_connections_hm_.at(player_id);
-                    const std::string player_address = "[" + socket.remote_endpoint().address().to_string() + "]:" + std::to_string(socket.remote_endpoint().port());
+                    // Address and port were saved when connection was accepted.
+                    const std::string &player_address = open_connections_hm_.at(player_id)->address;
                     BOOST_LOG_TRIVIAL(debug) << "New player address: " << player_address;
                     player_t new_player = player_t{.name = join.name, .address = player_address};
 
-                    game_state_.players.insert({player_id, new_player});
+                    players_.insert({player_id, new_player});
 
                     // Send information about new cliento to everyone and store this message.
                     AcceptedPlayer accepted_player(player_id, new_player);
@@ -284,7 +838,7 @@ namespace bomberman
                     accepted_player_messages_l_.push_back(accepted_player);
                 }
 
-                if (game_state_.players.size() == args_.players_count)
+                if (players_.size() == args_.players_count)
                     break;
             }
 
@@ -296,212 +850,87 @@ namespace bomberman
 
             send_messages();
 
-            if (game_state_.players.size() == args_.players_count)
+            if (players_.size() == args_.players_count)
                 start_game();
         }
 
         void start_game()
         {
             // All variables should be zeroed in end_game()
-            assert(game_state_.players.size() == args_.players_count);
-            assert(game_state_.blocks.size() == 0);
-            assert(game_state_.bombs.size() == 0);
-            assert(game_state_.player_to_position.size() == 0);
-            assert(game_state_.scores.size() == 0);
-            assert(turn_messages_l_.size() == 0);
-
-            messages_to_send_q_.push(target_all_t{.message = GameStarted(game_state_.players)});
+            assert(players_.size() == args_.players_count);
+            assert(!snapshot_ && turns_since_snapshot_.empty() && turns_since_snapshot_chunks_.empty());
+
+            messages_to_send_q_.push(target_all_t{.message = GameStarted(players_)});
             state_ = GAME;
+            update_free_lobby_slots();
 
-            events_t events;
+            if (recorder_)
+                recorder_->record_game_started(players_);
+            events_t events = engine_.start_game(players_);
 
-            // Generate random players positions and set their scores to zero.
-            for (auto &[player_id, _] : game_state_.players)
-            {
-                position_t player_position{
-                    .x = static_cast<size_x_t>(random_() % (long unsigned int)args_.size_x),
-                    .y = static_cast<size_y_t>(random_() % (long unsigned int)args_.size_y),
-                };
-                game_state_.player_to_position.insert({player_id, player_position});
-                game_state_.scores[player_id] = 0;
-                events.push_back(PlayerMoved(player_id, player_position));
-            }
+            send_messages();
 
-            // Generate random blocks
-            for (auto i = 0; i < args_.initial_blocks; i++)
+            // Turn 0 tells about all regions, so they need no region snapshot.
+            if (args_.interest_tile)
             {
-
-                position_t block_position{
-                    .x = static_cast<size_x_t>(random_() % (long unsigned int)args_.size_x),
-                    .y = static_cast<size_y_t>(random_() % (long unsigned int)args_.size_y),
-                };
-                // Add BlockPlaced only if the block has really been placed
-                if (game_state_.blocks.insert(block_position).second)
-                {
-                    events.push_back(BlockPlaced(block_position));
-                }
+                for (const auto &[player_id, position] : engine_.state().player_to_position)
+                    interest_->move(player_id, position, 0);
+                std::fill(robot_positions_.begin(), robot_positions_.end(), std::nullopt);
+                for (player_to_position_t &told_positions : told_positions_)
+                    told_positions.clear();
+                bomb_watchers_.clear();
             }
 
-            Turn turn(0, events);
-            messages_to_send_q_.push(target_all_t{.message = turn});
-            turn_messages_l_.push_back(turn);
-
-            send_messages();
+            // Nothing happened before turn 0, so snapshot is empty and turn 0 is the first turn after it.
+            snapshot_ = std::make_shared<const buffer_t>();
+            snapshot_turn_ = 0;
+            Turn turn(0, std::move(events));
+            broadcast_turn(turn);
 
             // Set timer for turns.
             turn_timer_.expires_from_now(boost::posix_time::milliseconds(args_.turn_duration));
-            turn_timer_.async_wait(boost::bind(&RobotsServer::process_one_turn, this, boost::asio::placeholders::error));
+            turn_timer_.async_wait(boost::asio::bind_executor(game_strand_, boost::bind(&RobotsServer::process_one_turn, this, boost::asio::placeholders::error)));
         }
 
         void end_game()
         {
-            state_ = LOBBY;
-            clients_messages_hm_.clear();
-            accepted_player_messages_l_.clear();
-            turn_messages_l_.clear();
-
-            GameEnded game_ended(game_state_.scores);
-            messages_to_send_q_.push(target_all_t{.message = game_ended});
-
-            send_messages();
-
-            game_state_.reset();
-        }
-
-        void process_bombs(robots_destroyed_t &robots_destroyed, blocks_destroyed_t &blocks_destroyed, events_t &events)
-        {
-            // Calculate exploding bombs effects.
-            for (auto &[bomb_id, bomb] : game_state_.bombs)
+            // Spectators which dropped turns get them before GameEnded, so they end with the right scores.
+            // A turn still waiting on connection strand may be dropped after this check, then GameEnded
+            // alone brings the final scores.
+            if (args_.slow_consumer_policy == slow_consumer_policy_t::DropSpectatorTurns)
             {
-                // Bomb explodes.
-                if (!--bomb.timer)
+                std::vector<shared_buffer_t> buffers;
+                for (auto &[player_id, connection] : open_connections_hm_)
                 {
-                    BombExploded bomb_exploded;
-                    bomb_exploded.bomb_id = bomb_id;
-                    auto explosion_range = calculate_explosion_range(bomb.position, args_.explosion_radius, args_.size_x, args_.size_y, game_state_.blocks);
-                    for (const auto &position : explosion_range)
-                    {
-                        if (game_state_.blocks.contains(position))
-                        {
-                            blocks_destroyed.insert(position);
-                            bomb_exploded.blocks_destroyed.insert(position);
-                        }
-                        for (const auto &[player_id, player_position] : game_state_.player_to_position)
-                        {
-                            if (player_position == position)
-                            {
-                                robots_destroyed.insert(player_id);
-                                bomb_exploded.robots_destroyed.insert(player_id);
-                            }
-                        }
-                    }
-                    events.push_back(bomb_exploded);
+                    if (players_.contains(player_id) || !connection->desynced)
+                        continue;
+                    if (buffers.empty())
+                        buffers = resync_buffers();
+                    send_catch_up(connection, buffers, true);
                 }
             }
 
-            std::erase_if(game_state_.bombs,
-                          [](const auto &bomb_pair)
-                          {
-                              return !bomb_pair.second.timer;
-                          });
-            std::erase_if(game_state_.blocks,
-                          [&blocks_destroyed](const auto &block_position)
-                          {
-                              return blocks_destroyed.contains(block_position);
-                          });
-        }
-
-        std::optional<position_t> calculate_move(position_t position, Move &move)
-        {
-            int32_t x = static_cast<int32_t>(position.x);
-            int32_t y = static_cast<int32_t>(position.y);
-            switch (move.direction)
-            {
-            case bomberman::direction_t::Up:
-                y++;
-                break;
-            case bomberman::direction_t::Right:
-                x++;
-                break;
-            case bomberman::direction_t::Down:
-                y--;
-                break;
-            case bomberman::direction_t::Left:
-                x--;
-                break;
-            };
+            if (recorder_)
+                recorder_->flush();
 
-            if (x < 0 || y < 0 || x >= args_.size_x || y >= args_.size_y)
-                return {};
-            position.x = static_cast<size_x_t>(x);
-            position.y = static_cast<size_y_t>(y);
-            if (game_state_.blocks.contains(position))
-                return {};
-            else
-                return position;
-        }
+            state_ = LOBBY;
+            update_free_lobby_slots();
+            clients_messages_hm_.clear();
+            accepted_player_messages_l_.clear();
+            snapshot_.reset();
+            turns_since_snapshot_.clear();
+            turns_since_snapshot_chunks_.clear();
 
-        void process_player_turn(events_t &events, const player_id_t player_id, client_message_t &client_message)
-        {
-            std::visit(overloaded{// Join message, ignore in game
-                                  [](Join &) {},
-                                  // PlaceBomb message
-                                  [player_id, &events, this](PlaceBomb &)
-                                  {
-                                      const bomb_id_t bomb_id = game_state_.free_bomb_id++;
-                                      bomb_t bomb{
-                                          .position = game_state_.player_to_position[player_id],
-                                          .timer = args_.bomb_timer,
-                                      };
-                                      game_state_.bombs.insert({bomb_id, bomb});
-                                      events.push_back(BombPlaced(bomb_id, bomb.position));
-                                  },
-                                  // PlaceBlock message
-                                  [player_id, &events, this](PlaceBlock &)
-                                  {
-                                      position_t block_position = game_state_.player_to_position[player_id];
-                                      if (game_state_.blocks.insert(block_position).second)
-                                      {
-                                          events.push_back(BlockPlaced(block_position));
-                                      }
-                                  },
-                                  // Move message
-                                  [player_id, &events, this](Move &move)
-                                  {
-                                      position_t position = game_state_.player_to_position[player_id];
-                                      auto new_position = calculate_move(position, move);
-                                      if (new_position)
-                                      {
-                                          game_state_.player_to_position[player_id] = new_position.value();
-                                          events.push_back(PlayerMoved(player_id, new_position.value()));
-                                      }
-                                  }},
-                       client_message);
-        }
+            scores_t scores = engine_.state().scores;
+            GameEnded game_ended(scores);
+            messages_to_send_q_.push(target_all_t{.message = game_ended});
 
-        void process_players(robots_destroyed_t &robots_destroyed, events_t &events)
-        {
-            for (auto &[player_id, player] : game_state_.players)
-            {
-                if (!robots_destroyed.contains(player_id))
-                {
-                    auto player_message_it = clients_messages_hm_.find(player_id);
-                    if (player_message_it != clients_messages_hm_.end())
-                    {
-                        process_player_turn(events, player_id, player_message_it->second);
-                    }
-                }
-                else
-                {
-                    position_t player_new_position{
-                        .x = static_cast<size_x_t>(random_() % (long unsigned int)args_.size_x),
-                        .y = static_cast<size_y_t>(random_() % (long unsigned int)args_.size_y),
-                    };
-                    game_state_.player_to_position[player_id] = player_new_position;
-                    events.push_back(PlayerMoved(player_id, player_new_position));
-                }
-            }
-            clients_messages_hm_.clear();
+            send_messages();
+
+            players_.clear();
+            engine_.reset();
+            if (interest_)
+                interest_->clear();
         }
 
         void process_one_turn(const boost::system::error_code &ec)
@@ -512,45 +941,66 @@ namespace bomberman
                 throw TimerError("Error in turn_timer_.async_wait", ec);
             }
 
-            robots_destroyed_t robots_destroyed;
-            blocks_destroyed_t blocks_destroyed;
-            events_t events;
-
-            process_bombs(robots_destroyed, blocks_destroyed, events);
-            process_players(robots_destroyed, events);
-            // Add scores to players whose rob was destroyed.
-            for (auto player_id : robots_destroyed)
-                game_state_.scores[player_id]++;
-
-            Turn turn(++game_state_.turn, events);
-            turn_messages_l_.push_back(turn);
+            if (recorder_)
+                recorder_->record_turn(clients_messages_hm_, players_);
+            events_t events = engine_.step(clients_messages_hm_);
+            clients_messages_hm_.clear();
 
-            messages_to_send_q_.push(target_all_t{.message = turn});
-            send_messages();
+            Turn turn(engine_.state().turn, std::move(events));
+            broadcast_turn(turn);
+            // Old snapshot is dropped, the next player joining gets a new one.
+            if (args_.snapshot_catch_up && snapshot_ && engine_.state().turn - snapshot_turn_ >= SNAPSHOT_INTERVAL)
+            {
+                snapshot_.reset();
+                turns_since_snapshot_.clear();
+                turns_since_snapshot_chunks_.clear();
+            }
 
-            if (game_state_.turn == args_.game_length)
+            if (engine_.finished())
             {
                 end_game();
             }
             else
             {
                 turn_timer_.expires_at(turn_timer_.expires_at() + boost::posix_time::milliseconds(args_.turn_duration));
-                turn_timer_.async_wait(boost::bind(&RobotsServer::process_one_turn, this, boost::asio::placeholders::error));
+                turn_timer_.async_wait(boost::asio::bind_executor(game_strand_, boost::bind(&RobotsServer::process_one_turn, this, boost::asio::placeholders::error)));
             }
         }
 
     private:
         const robots_server_args_t args_;
         boost::asio::io_context &io_context_;
-        game_state_t game_state_;
-        std::minstd_rand random_;
-        boost::asio::ip::tcp::acceptor acceptor_;
+        boost::asio::strand<boost::asio::io_context::executor_type> game_strand_;
+        // Players accepted in lobby, they take part in the next or current game.
+        players_t players_;
+        GameEngine engine_;
+        std::optional<GameRecorder> recorder_;
         boost::asio::deadline_timer turn_timer_;
         std::unordered_map<player_id_t, client_message_t> clients_messages_hm_;
         std::list<AcceptedPlayer> accepted_player_messages_l_;
-        std::list<Turn> turn_messages_l_;
+        // Encoded snapshot of the game and encoded turns played after it: chunks already sent to newcomers
+        // and turns encoded since. Without snapshot no turns are kept.
+        shared_buffer_t snapshot_;
+        buffer_t turns_since_snapshot_;
+        std::vector<shared_buffer_t> turns_since_snapshot_chunks_;
+        turn_t snapshot_turn_;
+        // Interest regions of players and events of the current turn for every player, see send_interest_turns.
+        // Empty without interest regions.
+        std::optional<interest_index_t> interest_;
+        std::vector<events_t> interest_events_;
+        events_t turn_events_;
+        // Robots destroyed sent to every player in the current turn with BombExploded of real bombs.
+        std::vector<players_mask_t> robots_destroyed_sent_;
+        // Positions of robots sent in the last PlayerMoved, for everyone and for every player.
+        std::vector<std::optional<position_t>> robot_positions_;
+        std::vector<player_to_position_t> told_positions_;
+        // Players told about every live bomb.
+        std::unordered_map<bomb_id_t, players_mask_t> bomb_watchers_;
         std::queue<targeted_message_t> messages_to_send_q_;
-        std::unordered_map<player_id_t, boost::asio::ip::tcp::socket> open_connections_hm_;
+        std::unordered_map<player_id_t, connection_ptr_t> open_connections_hm_;
+        // Lobby slots for open connections and those slots without places reserved for connections in transit.
+        int lobby_slots_;
+        std::atomic<int> free_lobby_slots_;
         enum server_state_t
         {
             LOBBY,
@@ -558,10 +1008,187 @@ namespace bomberman
         } state_;
     };
 
-    robots_server_args_t get_server_arguments(int ac, char *av[])
+    // Hosts many independent rooms (RobotsServer instances) in one process. Rooms are spread over one
+    // io_context per CPU core, each run by io_threads threads. New connections are routed to the next
+    // room with a free lobby slot, or round robin as observers if all lobbies are full.
+    class RoomManager
+    {
+    public:
+        RoomManager(const std::vector<robots_server_args_t> &rooms_args, const uint16_t port, const uint16_t io_threads)
+            : io_threads_(std::max<uint16_t>(1, io_threads)),
+              io_contexts_(std::max<std::size_t>(1, std::min<std::size_t>(rooms_args.size(), std::thread::hardware_concurrency()))),
+              acceptor_(io_contexts_.front(), boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v6(), port)),
+              next_room_(0)
+        {
+            if (rooms_args.empty())
+                throw InvalidArguments("server must host at least one room");
+
+            for (auto &io_context : io_contexts_)
+                work_guards_.emplace_back(boost::asio::make_work_guard(io_context));
+            for (std::size_t i = 0; i < rooms_args.size(); i++)
+                rooms_.push_back(std::make_unique<RobotsServer>(rooms_args[i], io_contexts_[i % io_contexts_.size()]));
+
+            connect_loop();
+        }
+
+        // Runs all io_contexts, the first one on calling thread. Rethrows first exception thrown by any room.
+        void run()
+        {
+            std::vector<std::thread> threads;
+            for (std::size_t i = 1; i < io_contexts_.size() * io_threads_; i++)
+                threads.emplace_back([this, i]()
+                                     { run_context(io_contexts_[i % io_contexts_.size()]); });
+            run_context(io_contexts_.front());
+            for (auto &thread : threads)
+                thread.join();
+
+            if (error_)
+                std::rethrow_exception(error_);
+        }
+
+    private:
+        void run_context(boost::asio::io_context &io_context)
+        {
+            try
+            {
+                io_context.run();
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(error_mutex_);
+                if (!error_)
+                    error_ = std::current_exception();
+                for (auto &other : io_contexts_)
+                    other.stop();
+            }
+        }
+
+        void connect_loop()
+        {
+            acceptor_.async_accept(
+                [this](boost::system::error_code ec, boost::asio::ip::tcp::socket socket)
+                {
+                    if (!ec)
+                    {
+                        // Turn off Nagle's algorithm
+                        boost::asio::ip::tcp::no_delay option(true);
+                        socket.set_option(option);
+                        route_connection(std::move(socket));
+                    }
+                    else
+                    {
+                        BOOST_LOG_TRIVIAL(debug) << "Error in connect_loop, " << ec.message();
+                    }
+
+                    connect_loop();
+                });
+        }
+
+        void route_connection(boost::asio::ip::tcp::socket &&socket)
+        {
+            for (std::size_t i = 0; i < rooms_.size(); i++)
+            {
+                RobotsServer &room = *rooms_[(next_room_ + i) % rooms_.size()];
+                if (room.reserve_lobby_slot())
+                {
+                    // Stay with this room until its lobby is full, so games start as soon as possible.
+                    next_room_ = (next_room_ + i) % rooms_.size();
+                    room.accept_connection(std::move(socket), true);
+                    return;
+                }
+            }
+            RobotsServer &room = *rooms_[next_room_];
+            next_room_ = (next_room_ + 1) % rooms_.size();
+            room.accept_connection(std::move(socket), false);
+        }
+
+        const uint16_t io_threads_;
+        std::deque<boost::asio::io_context> io_contexts_;
+        std::vector<boost::asio::executor_work_guard<boost::asio::io_context::executor_type>> work_guards_;
+        std::vector<std::unique_ptr<RobotsServer>> rooms_;
+        boost::asio::ip::tcp::acceptor acceptor_;
+        std::size_t next_room_;
+        std::mutex error_mutex_;
+        std::exception_ptr error_;
+    };
+
+    // Arguments of the whole server process: listening port and arguments of every hosted room.
+    struct robots_rooms_args_t
+    {
+        uint16_t port;
+        uint16_t io_threads;
+        std::vector<robots_server_args_t> rooms;
+    };
+
+    namespace
     {
-        boost::program_options::options_description desc("Usage");
-        desc.add_options()("-h", "produce help message")("-b", boost::program_options::value<bomb_timer_t>(), "bomb-timer <u16>")("-c", boost::program_options::value<uint16_t>(), "players-count <u8>")("-d", boost::program_options::value<turn_duration_t>(), "turn-duration <u64, milisekundy>")("-e", boost::program_options::value<explosion_radius_t>(), "explosion-radius <u16>")("-k", boost::program_options::value<uint16_t>(), "initial-blocks <u16>")("-l", boost::program_options::value<game_length_t>(), "game-length <u16>")("-n", boost::program_options::value<std::string>(), "server-name <String>")("-p", boost::program_options::value<uint16_t>(), "port <u16>")("-s", boost::program_options::value<uint32_t>()->default_value(static_cast<uint32_t>(time(NULL))), "seed <u32, parametr opcjonalny>")("-x", boost::program_options::value<size_x_t>(), "size-x <u16>")("-y", boost::program_options::value<size_y_t>(), "size-y <u16>");
+        boost::program_options::options_description server_options_description()
+        {
+            boost::program_options::options_description desc("Usage");
+            desc.add_options()("-h", "produce help message")("-b", boost::program_options::value<bomb_timer_t>(), "bomb-timer <u16>")("-c", boost::program_options::value<uint16_t>(), "players-count <u8>")("-d", boost::program_options::value<turn_duration_t>(), "turn-duration <u64, milisekundy>")("-e", boost::program_options::value<explosion_radius_t>(), "explosion-radius <u16>")("-k", boost::program_options::value<uint16_t>(), "initial-blocks <u16>")("-l", boost::program_options::value<game_length_t>(), "game-length <u16>")("-n", boost::program_options::value<std::string>(), "server-name <String>")("-p", boost::program_options::value<uint16_t>(), "port <u16>")("-s", boost::program_options::value<uint32_t>()->default_value(static_cast<uint32_t>(time(NULL))), "seed <u32, parametr opcjonalny>")("-x", boost::program_options::value<size_x_t>(), "size-x <u16>")("-y", boost::program_options::value<size_y_t>(), "size-y <u16>")("-r", boost::program_options::value<uint16_t>()->default_value(1), "rooms <u16, parametr opcjonalny>")("-f", boost::program_options::value<std::string>(), "rooms-file <String, parametr opcjonalny>, each line overrides options for one room")("-t", boost::program_options::value<uint16_t>()->default_value(1), "io-threads <u16, parametr opcjonalny>, threads running every io_context")("-R", boost::program_options::value<std::string>(), "record-file <String, parametr opcjonalny>, with many rooms room i records to record-file.i")("-w", boost::program_options::value<uint32_t>(), "write-queue-limit <u32, bytes, parametr opcjonalny>, high-watermark of bytes queued for one connection")("-W", boost::program_options::value<std::string>(), "slow-consumer-policy <disconnect or drop, parametr opcjonalny>, drop skips turns sent to spectators over write-queue-limit and later sends them GameStarted and the game so far again")("-a", boost::program_options::value<uint16_t>(), "interest-tile <u16, parametr opcjonalny>, players get only events within one tile of this size around their tile, 0 sends everything; catch-up of a region has turn numbers not above the current turn and robots destroyed elsewhere in BombExploded of bomb id 4294967295, only clients from this tree apply it correctly")("-S", boost::program_options::bool_switch(), "snapshot-catch-up <parametr opcjonalny>, late joiners get a snapshot of the game instead of all its turns, its turn numbers go backwards and only clients from this tree apply it correctly");
+            return desc;
+        }
+
+        // Copies every option given explicitly in vm to args.
+        void apply_server_arguments(const boost::program_options::variables_map &vm, robots_server_args_t &args)
+        {
+            auto given = [&vm](const char *option)
+            {
+                return vm.count(option) && !vm[option].defaulted();
+            };
+
+            if (given("-b"))
+                args.bomb_timer = vm["-b"].as<bomb_timer_t>();
+            if (given("-c"))
+            {
+                uint16_t players_count = vm["-c"].as<uint16_t>();
+                if (players_count > std::numeric_limits<uint8_t>::max())
+                    throw InvalidArguments("player counts must be unsigned 8-bits integer!");
+                else
+                    args.players_count = static_cast<players_count_t>(players_count);
+            }
+            if (given("-d"))
+                args.turn_duration = vm["-d"].as<turn_duration_t>();
+            if (given("-e"))
+                args.explosion_radius = vm["-e"].as<explosion_radius_t>();
+            if (given("-k"))
+                args.initial_blocks = vm["-k"].as<uint16_t>();
+            if (given("-l"))
+                args.game_length = vm["-l"].as<game_length_t>();
+            if (given("-n"))
+                args.server_name = vm["-n"].as<std::string>();
+            if (given("-p"))
+                args.port = vm["-p"].as<uint16_t>();
+            if (given("-s"))
+                args.seed = vm["-s"].as<uint32_t>();
+            if (given("-x"))
+                args.size_x = vm["-x"].as<size_x_t>();
+            if (given("-y"))
+                args.size_y = vm["-y"].as<size_y_t>();
+            if (given("-R"))
+                args.record_path = vm["-R"].as<std::string>();
+            if (given("-w"))
+                args.outbound_high_watermark = vm["-w"].as<uint32_t>();
+            if (given("-a"))
+                args.interest_tile = vm["-a"].as<uint16_t>();
+            if (given("-S"))
+                args.snapshot_catch_up = vm["-S"].as<bool>();
+            if (given("-W"))
+            {
+                const std::string policy = vm["-W"].as<std::string>();
+                if (policy == "disconnect")
+                    args.slow_consumer_policy = slow_consumer_policy_t::Disconnect;
+                else if (policy == "drop")
+                    args.slow_consumer_policy = slow_consumer_policy_t::DropSpectatorTurns;
+                else
+                    throw InvalidArguments("slow consumer policy must be disconnect or drop");
+            }
+        }
+    } // namespace
+
+    robots_rooms_args_t get_server_arguments(int ac, char *av[])
+    {
+        boost::program_options::options_description desc = server_options_description();
 
         boost::program_options::variables_map vm;
         boost::program_options::store(boost::program_options::parse_command_line(ac, av, desc), vm);
@@ -574,22 +1201,9 @@ namespace bomberman
         }
 
         robots_server_args_t args;
-
-        args.bomb_timer = vm["-b"].as<bomb_timer_t>();
-        uint16_t players_count = vm["-c"].as<uint16_t>();
-        if (args.players_count > std::numeric_limits<uint8_t>::max())
-            throw InvalidArguments("player counts must be unsigned 8-bits integer!");
-        else
-            args.players_count = static_cast<players_count_t>(players_count);
-        args.turn_duration = vm["-d"].as<turn_duration_t>();
-        args.explosion_radius = vm["-e"].as<explosion_radius_t>();
-        args.initial_blocks = vm["-k"].as<uint16_t>();
-        args.game_length = vm["-l"].as<game_length_t>();
-        args.server_name = vm["-n"].as<std::string>();
-        args.port = vm["-p"].as<uint16_t>();
+        apply_server_arguments(vm, args);
+        // Seed has a default value, so it is not covered by apply_server_arguments.
         args.seed = vm["-s"].as<uint32_t>();
-        args.size_x = vm["-x"].as<size_x_t>();
-        args.size_y = vm["-y"].as<size_y_t>();
 
         BOOST_LOG_TRIVIAL(debug) << "Server run with arguments: "
                                  << "\nargs.bomb_timer " << args.bomb_timer
@@ -601,9 +1215,64 @@ namespace bomberman
                                  << "\nargs.port " << args.port
                                  << "\nargs.seed " << args.seed
                                  << "\nargs.size_x " << args.size_x
-                                 << "\nargs.size_y " << args.size_y;
+                                 << "\nargs.size_y " << args.size_y
+                                 << "\nargs.record_path " << args.record_path
+                                 << "\nargs.outbound_high_watermark " << args.outbound_high_watermark
+                                 << "\nargs.interest_tile " << args.interest_tile
+                                 << "\nargs.snapshot_catch_up " << args.snapshot_catch_up;
+
+        robots_rooms_args_t rooms_args;
+        rooms_args.port = args.port;
+        rooms_args.io_threads = vm["-t"].as<uint16_t>();
+
+        if (vm.count("-f"))
+        {
+            // Every room starts from command line arguments and overrides them with its line of the file.
+            std::ifstream rooms_file(vm["-f"].as<std::string>());
+            if (!rooms_file)
+                throw InvalidArguments("can not open rooms file " + vm["-f"].as<std::string>());
+            std::string line;
+            while (std::getline(rooms_file, line))
+            {
+                if (line.empty())
+                    continue;
+                robots_server_args_t room_args = args;
+                room_args.seed = args.seed + static_cast<uint32_t>(rooms_args.rooms.size());
+                boost::program_options::variables_map room_vm;
+                boost::program_options::store(boost::program_options::command_line_parser(boost::program_options::split_unix(line)).options(desc).run(), room_vm);
+                // All rooms are reached through one listening socket.
+                if (room_vm.count("-p"))
+                    throw InvalidArguments("port can not be set for one room, rooms share port of the server");
+                apply_server_arguments(room_vm, room_args);
+                rooms_args.rooms.push_back(room_args);
+            }
+        }
+        else
+        {
+            // Rooms differ only by seed.
+            const uint16_t rooms = vm["-r"].as<uint16_t>();
+            for (uint16_t i = 0; i < rooms; i++)
+            {
+                robots_server_args_t room_args = args;
+                room_args.seed = args.seed + i;
+                rooms_args.rooms.push_back(room_args);
+            }
+        }
+
+        // Rooms must not append to the same record file.
+        if (rooms_args.rooms.size() > 1)
+        {
+            for (std::size_t i = 0; i < rooms_args.rooms.size(); i++)
+            {
+                robots_server_args_t &room_args = rooms_args.rooms[i];
+                if (!room_args.record_path.empty() && room_args.record_path == args.record_path)
+                    room_args.record_path += "." + std::to_string(i);
+            }
+        }
+
+        BOOST_LOG_TRIVIAL(debug) << "Server hosts " << rooms_args.rooms.size() << " rooms";
 
-        return args;
+        return rooms_args;
     }
 
 } // bomberman
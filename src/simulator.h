@@ -0,0 +1,331 @@
+#ifndef BOMBERMAN_SIMULATOR_H
+#define BOMBERMAN_SIMULATOR_H
+
+#include "engine.h"
+#include "errors.h"
+
+#include <boost/log/trivial.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <variant>
+#include <vector>
+
+namespace bomberman
+{
+
+    // Thread pool in which every worker has its own task deque. Worker takes tasks from the back of its
+    // own deque and, when it is empty, steals from the front of deques of other workers.
+    class WorkStealingPool
+    {
+    public:
+        using task_t = std::function<void()>;
+
+        explicit WorkStealingPool(const std::size_t threads_count)
+            : queues_(std::max<std::size_t>(1, threads_count)), next_queue_(0), pending_(0), queued_(0), stopping_(false)
+        {
+            for (std::size_t i = 0; i < queues_.size(); i++)
+                workers_.emplace_back([this, i]()
+                                      { work(i); });
+        }
+
+        ~WorkStealingPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(wait_mutex_);
+                stopping_ = true;
+            }
+            work_cv_.notify_all();
+            for (auto &worker : workers_)
+                worker.join();
+        }
+
+        void submit(task_t task)
+        {
+            // Counted before any worker can see the task, so pending_ never drops below zero.
+            {
+                std::lock_guard<std::mutex> lock(wait_mutex_);
+                pending_++;
+            }
+            worker_queue_t &queue = queues_[next_queue_++ % queues_.size()];
+            {
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                queue.tasks.push_back(std::move(task));
+                // Idle workers check queues under wait_mutex_ before sleeping, see work().
+                std::lock_guard<std::mutex> wait_lock(wait_mutex_);
+                queued_++;
+            }
+            work_cv_.notify_one();
+        }
+
+        // Blocks until every submitted task has finished. Rethrows the first exception thrown by a task since
+        // the last wait, other tasks are run anyway.
+        void wait()
+        {
+            std::unique_lock<std::mutex> lock(wait_mutex_);
+            done_cv_.wait(lock, [this]()
+                          { return pending_ == 0; });
+            if (error_)
+                std::rethrow_exception(std::exchange(error_, nullptr));
+        }
+
+    private:
+        struct worker_queue_t
+        {
+            std::mutex mutex;
+            std::deque<task_t> tasks;
+        };
+
+        std::optional<task_t> take_task(const std::size_t worker_idx)
+        {
+            // Own queue first, newest task.
+            {
+                worker_queue_t &own = queues_[worker_idx];
+                std::lock_guard<std::mutex> lock(own.mutex);
+                if (!own.tasks.empty())
+                {
+                    task_t task = std::move(own.tasks.back());
+                    own.tasks.pop_back();
+                    task_taken();
+                    return task;
+                }
+            }
+            // Steal oldest task of another worker.
+            for (std::size_t i = 1; i < queues_.size(); i++)
+            {
+                worker_queue_t &victim = queues_[(worker_idx + i) % queues_.size()];
+                std::lock_guard<std::mutex> lock(victim.mutex);
+                if (!victim.tasks.empty())
+                {
+                    task_t task = std::move(victim.tasks.front());
+                    victim.tasks.pop_front();
+                    task_taken();
+                    return task;
+                }
+            }
+            return {};
+        }
+
+        // Called with mutex of the queue task was taken from held, like queued_++ in submit().
+        void task_taken()
+        {
+            std::lock_guard<std::mutex> lock(wait_mutex_);
+            queued_--;
+        }
+
+        void work(const std::size_t worker_idx)
+        {
+            while (true)
+            {
+                std::optional<task_t> task = take_task(worker_idx);
+                if (task)
+                {
+                    std::exception_ptr error;
+                    try
+                    {
+                        (*task)();
+                    }
+                    catch (...)
+                    {
+                        error = std::current_exception();
+                    }
+                    std::lock_guard<std::mutex> lock(wait_mutex_);
+                    if (error && !error_)
+                        error_ = error;
+                    if (--pending_ == 0)
+                        done_cv_.notify_all();
+                    continue;
+                }
+
+                // Nothing to run or steal, sleep until new task is submitted. Tasks queued after take_task
+                // looked at the queues are seen under the lock, so no wakeup is missed.
+                std::unique_lock<std::mutex> lock(wait_mutex_);
+                work_cv_.wait(lock, [this]()
+                              { return stopping_ || queued_ > 0; });
+                if (stopping_ && queued_ == 0)
+                    return;
+            }
+        }
+
+        std::deque<worker_queue_t> queues_;
+        std::vector<std::thread> workers_;
+        std::atomic<std::size_t> next_queue_;
+        std::mutex wait_mutex_;
+        std::condition_variable work_cv_;
+        std::condition_variable done_cv_;
+        // Tasks submitted and not finished, and tasks waiting in queues, both guarded by wait_mutex_.
+        std::size_t pending_;
+        std::size_t queued_;
+        bool stopping_;
+        // First exception thrown by a task, rethrown by wait(). Guarded by wait_mutex_.
+        std::exception_ptr error_;
+    };
+
+    // Bot repeating given actions: U, R, D, L move, B places bomb, K places block, '.' does nothing.
+    struct scripted_bot_t
+    {
+        std::string script;
+        std::size_t next = 0;
+    };
+
+    // Bot choosing random action every turn.
+    struct random_bot_t
+    {
+        std::minstd_rand random;
+    };
+
+    // Bot which runs away from cells in range of live bombs and otherwise acts randomly.
+    struct evading_bot_t
+    {
+        std::minstd_rand random;
+    };
+
+    using bot_t = std::variant<scripted_bot_t, random_bot_t, evading_bot_t>;
+
+    namespace
+    {
+        std::optional<client_message_t> random_action(std::minstd_rand &random)
+        {
+            switch (random() % 6)
+            {
+            case 0:
+                return PlaceBomb{};
+            case 1:
+                return PlaceBlock{};
+            default:
+                return Move{static_cast<direction_t>(random() % 4)};
+            }
+        }
+
+        bool in_bomb_range(const GameEngine &engine, const position_t &position)
+        {
+            for (const auto &[_, bomb] : engine.state().bombs)
+            {
+                if (calculate_explosion(bomb.position, engine.args().explosion_radius, engine.state().blocks).contains(position))
+                    return true;
+            }
+            return false;
+        }
+
+        std::optional<client_message_t> choose_action(scripted_bot_t &bot, const GameEngine &, const player_id_t)
+        {
+            if (bot.script.empty())
+                return {};
+            const char action = bot.script[bot.next++ % bot.script.size()];
+            switch (action)
+            {
+            case 'U':
+                return Move{direction_t::Up};
+            case 'R':
+                return Move{direction_t::Right};
+            case 'D':
+                return Move{direction_t::Down};
+            case 'L':
+                return Move{direction_t::Left};
+            case 'B':
+                return PlaceBomb{};
+            case 'K':
+                return PlaceBlock{};
+            default:
+                return {};
+            }
+        }
+
+        std::optional<client_message_t> choose_action(random_bot_t &bot, const GameEngine &, const player_id_t)
+        {
+            return random_action(bot.random);
+        }
+
+        std::optional<client_message_t> choose_action(evading_bot_t &bot, const GameEngine &engine, const player_id_t player_id)
+        {
+            const position_t position = engine.state().player_to_position.at(player_id);
+            if (!in_bomb_range(engine, position))
+                return random_action(bot.random);
+
+            // Try directions starting from a random one, take first safe cell, or any reachable one.
+            std::optional<client_message_t> fallback;
+            const uint32_t first = bot.random() % 4;
+            for (uint32_t i = 0; i < 4; i++)
+            {
+                const direction_t direction = static_cast<direction_t>((first + i) % 4);
+                const auto new_position = calculate_move(position, direction, engine.state().blocks);
+                if (!new_position)
+                    continue;
+                if (!in_bomb_range(engine, new_position.value()))
+                    return Move{direction};
+                if (!fallback)
+                    fallback = Move{direction};
+            }
+            return fallback;
+        }
+    } // namespace
+
+    // Parameters of one simulated game.
+    struct simulated_game_t
+    {
+        robots_server_args_t args;
+        std::vector<bot_t> bots;
+    };
+
+    struct simulation_result_t
+    {
+        scores_t scores;
+        std::size_t turns;
+    };
+
+    // Plays whole game without network and timers. Bot number i plays as player with id i.
+    simulation_result_t simulate_game(simulated_game_t &game)
+    {
+        GameEngine engine(game.args);
+        players_t players;
+        for (std::size_t i = 0; i < game.bots.size(); i++)
+            players.insert({static_cast<player_id_t>(i), player_t{.name = "bot" + std::to_string(i), .address = "simulated"}});
+
+        engine.start_game(players);
+        player_inputs_t inputs;
+        std::size_t turns = 0;
+        while (!engine.finished())
+        {
+            inputs.clear();
+            for (std::size_t i = 0; i < game.bots.size(); i++)
+            {
+                const player_id_t player_id = static_cast<player_id_t>(i);
+                auto action = std::visit([&engine, player_id](auto &bot)
+                                         { return choose_action(bot, engine, player_id); },
+                                         game.bots[i]);
+                if (action)
+                    inputs.insert({player_id, action.value()});
+            }
+            engine.step(inputs);
+            turns++;
+        }
+
+        return simulation_result_t{.scores = engine.state().scores, .turns = turns};
+    }
+
+    // Creates bot from its description: "random", "evade", "idle" or "script:<actions>".
+    bot_t make_bot(const std::string &description, const uint32_t seed)
+    {
+        if (description == "random")
+            return random_bot_t{std::minstd_rand(seed)};
+        if (description == "evade")
+            return evading_bot_t{std::minstd_rand(seed)};
+        if (description == "idle")
+            return scripted_bot_t{.script = ""};
+        const std::string script_prefix = "script:";
+        if (description.starts_with(script_prefix))
+            return scripted_bot_t{.script = description.substr(script_prefix.size())};
+        throw InvalidArguments("unknown bot " + description);
+    }
+
+} // namespace bomberman
+
+#endif // BOMBERMAN_SIMULATOR_H
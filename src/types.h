@@ -4,6 +4,9 @@
 #include <boost/asio.hpp>
 
 #include <list>
+#include <memory_resource>
+#include <span>
+#include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
 #include <variant>
@@ -39,11 +42,34 @@ namespace bomberman
         {
             return (x == other.x) & (y == other.y);
         }
+
+        // Position as one 32-bit key, x in the high half.
+        constexpr uint32_t packed() const noexcept
+        {
+            return (static_cast<uint32_t>(x) << 16) | y;
+        }
+
+        static constexpr position_t unpacked(const uint32_t key) noexcept
+        {
+            return position_t{.x = static_cast<uint16_t>(key >> 16), .y = static_cast<uint16_t>(key)};
+        }
+
+        // Finalizer of MurmurHash3, every bit of key changes about half of the bits of the result.
+        static constexpr uint32_t mix(uint32_t key) noexcept
+        {
+            key ^= key >> 16;
+            key *= 0x85ebca6bU;
+            key ^= key >> 13;
+            key *= 0xc2b2ae35U;
+            key ^= key >> 16;
+            return key;
+        }
+
         struct hash
         {
             std::size_t operator()(const position_t &position) const noexcept
             {
-                return std::hash<uint16_t>{}(position.x) ^ std::hash<uint16_t>{}(position.y);
+                return mix(position.packed());
             }
         };
     };
@@ -59,6 +85,20 @@ namespace bomberman
         bomb_timer_t timer;
     };
 
+    // Bomb as stored in game state. Its timer is not counted down every turn,
+    // it is derived from the turn in which the bomb was placed.
+    struct placed_bomb_t
+    {
+        position_t position;
+        turn_t placed_turn;
+
+        bomb_timer_t timer_at(const turn_t turn, const bomb_timer_t bomb_timer) const noexcept
+        {
+            const turn_t elapsed = turn - placed_turn;
+            return elapsed < bomb_timer ? static_cast<bomb_timer_t>(bomb_timer - elapsed) : 0;
+        }
+    };
+
     enum class direction_t : uint8_t
     {
         Up = 0,
@@ -105,21 +145,19 @@ namespace bomberman
         BlockPlaced = 3
     };
 
-    using position_set_t_ = std::unordered_set<position_t, position_t::hash>;
-
     using players_t = std::map<player_id_t, player_t>;
-    using robots_destroyed_t = std::unordered_set<player_id_t>;
-    using blocks_destroyed_t = position_set_t_;
+    // Sets built by the engine in one turn live in its turn arena, see GameEngine.
+    using robots_destroyed_t = std::pmr::unordered_set<player_id_t>;
     using player_positions_t = std::unordered_map<player_id_t, position_t>;
     using id_to_bomb_pos_t = std::unordered_map<bomb_id_t, position_t>;
     using player_to_position_t = std::unordered_map<player_id_t, position_t>;
-    using explosions_t = position_set_t_;
-    using blocks_t = position_set_t_;
-    using bombs_t = std::unordered_map<bomb_id_t, bomb_t>;
+    using bombs_t = std::pmr::unordered_map<bomb_id_t, placed_bomb_t>;
+    using bomb_list_t = std::vector<bomb_t>;
     using scores_t = std::unordered_map<player_id_t, score_t>;
 
     struct BombPlaced
     {
+        static constexpr event_code_t code = event_code_t::BombPlaced;
         BombPlaced(){};
         BombPlaced(bomb_id_t _bomb_id, position_t _position)
             : bomb_id(_bomb_id), position(_position) {}
@@ -127,19 +165,17 @@ namespace bomberman
         position_t position;
     };
 
+    // Robots and blocks destroyed by the explosion are parts of arrays of events_t holding the event.
     struct BombExploded
     {
-        BombExploded(){};
-        BombExploded(bomb_id_t _bomb_id,
-                     robots_destroyed_t &_robots_destroyed,
-                     blocks_destroyed_t &_blocks_destroyed)
-            : bomb_id(_bomb_id), robots_destroyed(_robots_destroyed), blocks_destroyed(_blocks_destroyed) {}
+        static constexpr event_code_t code = event_code_t::BombExploded;
         bomb_id_t bomb_id;
-        robots_destroyed_t robots_destroyed;
-        blocks_destroyed_t blocks_destroyed;
+        std::span<const player_id_t> robots_destroyed;
+        std::span<const position_t> blocks_destroyed;
     };
     struct PlayerMoved
     {
+        static constexpr event_code_t code = event_code_t::PlayerMoved;
         PlayerMoved(){};
         PlayerMoved(player_id_t _player_id, position_t _position)
             : player_id(_player_id), position(_position) {}
@@ -148,16 +184,157 @@ namespace bomberman
     };
     struct BlockPlaced
     {
+        static constexpr event_code_t code = event_code_t::BlockPlaced;
         BlockPlaced(){};
         BlockPlaced(position_t _position)
             : position(_position) {}
         position_t position;
     };
-    using event_t = std::variant<BombPlaced, BombExploded, PlayerMoved, BlockPlaced>;
-    using events_t = std::list<event_t>;
+
+    // Events of one turn. Every kind of event has its own contiguous array and order_ keeps kind and
+    // index of every event in the order in which they were added, which is the order they are sent in.
+    // Robots and blocks destroyed by all explosions of the turn are two more arrays, explosion only
+    // stores where its part of them ends.
+    class events_t
+    {
+    public:
+        events_t() {}
+        explicit events_t(std::pmr::memory_resource *resource)
+            : order_(resource), bombs_placed_(resource), bombs_exploded_(resource), players_moved_(resource),
+              blocks_placed_(resource), robots_destroyed_(resource), blocks_destroyed_(resource) {}
+
+        void push_back(const BombPlaced &bomb_placed) { add(bombs_placed_, bomb_placed); }
+        void push_back(const PlayerMoved &player_moved) { add(players_moved_, player_moved); }
+        void push_back(const BlockPlaced &block_placed) { add(blocks_placed_, block_placed); }
+
+        // Adds BombExploded, robots and blocks it destroyed are added to the last added one.
+        void push_bomb_exploded(const bomb_id_t bomb_id)
+        {
+            add(bombs_exploded_, exploded_t{.bomb_id = bomb_id,
+                                            .robots_end = static_cast<uint32_t>(robots_destroyed_.size()),
+                                            .blocks_end = static_cast<uint32_t>(blocks_destroyed_.size())});
+        }
+
+        void add_robot_destroyed(const player_id_t player_id)
+        {
+            robots_destroyed_.push_back(player_id);
+            bombs_exploded_.back().robots_end++;
+        }
+
+        void add_block_destroyed(const position_t &position)
+        {
+            blocks_destroyed_.push_back(position);
+            bombs_exploded_.back().blocks_end++;
+        }
+
+        // Adds all events of other after events of this one.
+        void append(const events_t &other)
+        {
+            other.for_each([this](const auto &event)
+                           {
+                               if constexpr (std::is_same_v<std::decay_t<decltype(event)>, BombExploded>)
+                               {
+                                   push_bomb_exploded(event.bomb_id);
+                                   for (const player_id_t robot_destroyed : event.robots_destroyed)
+                                       add_robot_destroyed(robot_destroyed);
+                                   for (const position_t &block_destroyed : event.blocks_destroyed)
+                                       add_block_destroyed(block_destroyed);
+                               }
+                               else
+                                   push_back(event); });
+        }
+
+        std::size_t size() const noexcept { return order_.size(); }
+        bool empty() const noexcept { return order_.empty(); }
+
+        void clear()
+        {
+            order_.clear();
+            bombs_placed_.clear();
+            bombs_exploded_.clear();
+            players_moved_.clear();
+            blocks_placed_.clear();
+            robots_destroyed_.clear();
+            blocks_destroyed_.clear();
+        }
+
+        const std::pmr::vector<BombPlaced> &bombs_placed() const noexcept { return bombs_placed_; }
+        const std::pmr::vector<PlayerMoved> &players_moved() const noexcept { return players_moved_; }
+        const std::pmr::vector<BlockPlaced> &blocks_placed() const noexcept { return blocks_placed_; }
+        std::size_t bombs_exploded_count() const noexcept { return bombs_exploded_.size(); }
+        std::size_t robots_destroyed_count() const noexcept { return robots_destroyed_.size(); }
+        std::size_t blocks_destroyed_count() const noexcept { return blocks_destroyed_.size(); }
+
+        // Calls f with every event in order.
+        template <typename F>
+        void for_each(F f) const
+        {
+            for (const entry_t &entry : order_)
+            {
+                switch (entry.code)
+                {
+                case event_code_t::BombPlaced:
+                    f(bombs_placed_[entry.index]);
+                    break;
+                case event_code_t::BombExploded:
+                    f(bomb_exploded(entry.index));
+                    break;
+                case event_code_t::PlayerMoved:
+                    f(players_moved_[entry.index]);
+                    break;
+                case event_code_t::BlockPlaced:
+                    f(blocks_placed_[entry.index]);
+                    break;
+                }
+            }
+        }
+
+    private:
+        struct entry_t
+        {
+            event_code_t code;
+            uint32_t index;
+        };
+
+        // Robots and blocks of explosion start where they end for the previous one.
+        struct exploded_t
+        {
+            static constexpr event_code_t code = event_code_t::BombExploded;
+            bomb_id_t bomb_id;
+            uint32_t robots_end;
+            uint32_t blocks_end;
+        };
+
+        template <typename E>
+        void add(std::pmr::vector<E> &events, const E &event)
+        {
+            order_.push_back(entry_t{.code = E::code, .index = static_cast<uint32_t>(events.size())});
+            events.push_back(event);
+        }
+
+        BombExploded bomb_exploded(const uint32_t index) const
+        {
+            const exploded_t &exploded = bombs_exploded_[index];
+            const uint32_t robots_begin = index ? bombs_exploded_[index - 1].robots_end : 0;
+            const uint32_t blocks_begin = index ? bombs_exploded_[index - 1].blocks_end : 0;
+            return BombExploded{
+                .bomb_id = exploded.bomb_id,
+                .robots_destroyed = std::span(robots_destroyed_.data() + robots_begin, exploded.robots_end - robots_begin),
+                .blocks_destroyed = std::span(blocks_destroyed_.data() + blocks_begin, exploded.blocks_end - blocks_begin),
+            };
+        }
+
+        std::pmr::vector<entry_t> order_;
+        std::pmr::vector<BombPlaced> bombs_placed_;
+        std::pmr::vector<exploded_t> bombs_exploded_;
+        std::pmr::vector<PlayerMoved> players_moved_;
+        std::pmr::vector<BlockPlaced> blocks_placed_;
+        std::pmr::vector<player_id_t> robots_destroyed_;
+        std::pmr::vector<position_t> blocks_destroyed_;
+    };
 
     // size of move message
-    static constinit std::size_t MAX_GUI_TO_CLIENT_MESSAGE_SIZE = sizeof(message_code_t) + sizeof(direction_t);
+    inline constexpr std::size_t MAX_GUI_TO_CLIENT_MESSAGE_SIZE = sizeof(message_code_t) + sizeof(direction_t);
 
 } // bomberman
 